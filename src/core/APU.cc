@@ -1,5 +1,6 @@
 #include "APU.h"
 
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
 
@@ -7,7 +8,7 @@
 #include "glog/logging.h"
 
 #define APU_FLOAT_MIX
-//#define APU_MAKE_CYCLE
+//#define APU_MIX_RANGE  // log the range of the mixer output
 
 // Ref:
 //    https://wiki.nesdev.org/w/index.php?title=APU
@@ -15,10 +16,7 @@
 
 namespace hn {
 constexpr float kNtscCPURate = 1789773.0;
-constexpr int kSamplesPerSecond = 44100;
 constexpr int kFramesPerSecond = 60;
-constexpr int kSamplesPerFRAME = kSamplesPerSecond / kFramesPerSecond;
-constexpr float kCpuCyclePerSample = kNtscCPURate / kSamplesPerSecond;
 constexpr float kCpuCyclePerFrame = kNtscCPURate / kFramesPerSecond;
 constexpr float kCpuCyclePerFrameSegment = kCpuCyclePerFrame / 3;
 
@@ -30,9 +28,81 @@ enum {
   Pulse1Enable = 1
 };
 
-APU::APU(MainBus &bus) : bus_(bus), dmc_channel_(bus), speaker_(nullptr) {}
+#ifdef APU_FLOAT_MIX
+// Nonlinear mixer outputs for every level the channels may output:
+// pulses 0-15 each, triangle 0-15, noise 0-15, DMC 0-127
+//
+//  https://wiki.nesdev.org/w/index.php?title=APU_Mixer
+//
+static const struct MixerTables {
+  MixerTables() {
+    for (int n = 0; n < 31; ++n) {
+      pulse[n] = 95.88f / ((8128.f / n) + 100.f);
+    }
+
+    for (int t = 0; t < 16; ++t) {
+      for (int n = 0; n < 16; ++n) {
+        for (int d = 0; d < 128; ++d) {
+          float sum = t / 8227.f + n / 12241.f + d / 22638.f;
+          tnd[t][n][d] = 159.79f / (1.f / sum + 100.f);
+        }
+      }
+    }
+  }
+
+  float pulse[31];
+  float tnd[16][16][128];
+} kMixerTables;
+#endif  // APU_FLOAT_MIX
+
+APU::APU(MainBus &bus)
+    : pulses_(),
+      triangle_(),
+      noise_(),
+      dmc_channel_(bus),
+      bus_(bus),
+      speaker_(nullptr) {
+  // Room for a change every 4 cycles of a frame segment, no reallocation
+  for (auto &changes : changes_) {
+    changes.reserve(kCpuCyclePerFrameSegment / 4 + 1);
+  }
+}
+
+void APU::SetSpeaker(VirtualSpeaker *speaker) {
+  speaker_ = speaker;
+  if (speaker_) blip_.SetRates(kNtscCPURate, speaker_->sampleRate());
+}
+
+void APU::SetAudioEnabled(bool enabled) {
+  if (audio_enabled_ == enabled) return;
+
+  RunChannels(sample_cycle_);
+  audio_enabled_ = enabled;
+  if (audio_enabled_) {
+    UpdateChannels();
+    blip_.Clear();
+  }
+}
+
+void APU::SetRunAhead(bool ahead) {
+  if (running_ahead_ == ahead) return;
+
+  running_ahead_ = ahead;
+  if (running_ahead_) {
+    RunChannels(sample_cycle_);
+    audio_ahead_ = audio_enabled_;
+    audio_enabled_ = false;
+  } else {
+    // Back at the state the samples were made up to
+    audio_enabled_ = audio_ahead_;
+    UpdateChannels();
+  }
+}
 
 void APU::Write(Address address, Byte data) {
+  // The write takes effect from the current cycle on
+  RunChannels(sample_cycle_);
+
   if (0x4000 <= address && address < 0x4008) {
     auto *pulse = &pulses_[address < 0x4004 ? 0 : 1];
     pulse->WriteControl(address, data);
@@ -79,6 +149,8 @@ void APU::Write(Address address, Byte data) {
   } else {
     LOG(ERROR) << "unknown address " << std::hex << address;
   }
+
+  UpdateChannels();
 }
 
 void APU::Reset() {
@@ -90,12 +162,18 @@ void APU::Reset() {
   sample_cycle_ = 0;
   frame_cycle_ = 0;
   sample_segment_ = 0;
+  channel_cycle_ = 0;
+
+  UpdateChannels();
+  blip_.Clear();
 
   if (speaker_) speaker_->Play();
 }
 
 uint8_t APU::Read(uint16_t address) {
   if (address == 0x4015) {
+    RunChannels(sample_cycle_);
+
     uint8_t state = 0;
     if (pulses_[0].lengthCounter_) state |= 0x1;
     if (pulses_[1].lengthCounter_) state |= 0x2;
@@ -153,10 +231,8 @@ int16_t APU::SoundMixer(Byte pulse1, Byte pulse2, Byte triangle, Byte noise,
                         Byte dmc) {
 #ifdef APU_FLOAT_MIX
   //
-  float square_out = 95.88f / ((8128.f / (pulse1 + pulse2)) + 100.f);
-  float tnd_out =
-      159.79f /
-      (1.f / (triangle / 8227.f + noise / 12241.f + dmc / 22638.f) + 100.f);
+  float square_out = kMixerTables.pulse[pulse1 + pulse2];
+  float tnd_out = kMixerTables.tnd[triangle][noise][dmc];
 #else   // APU_FLOAT_MIX
   //Խ
   float square_out = 0.00752 * ((int64_t)pulse1 + pulse2);
@@ -165,6 +241,7 @@ int16_t APU::SoundMixer(Byte pulse1, Byte pulse2, Byte triangle, Byte noise,
 
   float outputf = (float)(square_out + tnd_out);
   outputf *= 32767.f;
+#ifdef APU_MIX_RANGE
   static float maxv = -1e30, minv = 1e30;
   if (maxv < outputf || minv > outputf) {
     if (maxv < outputf) maxv = outputf;
@@ -172,6 +249,7 @@ int16_t APU::SoundMixer(Byte pulse1, Byte pulse2, Byte triangle, Byte noise,
 
     VLOG(2) << "mixer range(" << minv << "," << maxv << ")";
   }
+#endif  // APU_MIX_RANGE
 
   if (outputf > 0x7FFF)
     outputf = 0x7FFF;
@@ -182,48 +260,123 @@ int16_t APU::SoundMixer(Byte pulse1, Byte pulse2, Byte triangle, Byte noise,
 }
 
 void APU::Step() {
+  ++sample_cycle_;
   if (++frame_cycle_ >= kCpuCyclePerFrame / 4) {
     frame_cycle_ = 0;
+    RunChannels(sample_cycle_);
     ProcessFrameCounter();
+    UpdateChannels();
   }
 
-  if (++sample_cycle_ < kCpuCyclePerFrameSegment) {
+  if (sample_cycle_ < kCpuCyclePerFrameSegment) {
     return;
   }
 
+  MakeSamples();
   sample_cycle_ = 0;
+}
 
-  MakeSamples(0);
+void APU::Run(std::size_t cycles) {
+  while (cycles > 0) {
+    // No event happens before the last cycle of the step, skip right to it
+    std::size_t step = std::min(cycles, CyclesToEvent());
+    frame_cycle_ += step - 1;
+    sample_cycle_ += step - 1;
+    cycles -= step;
 
-  if (speaker_)
-    speaker_->PushSample(output_samples_.data(), output_samples_.size());
+    Step();
+  }
 }
 
-uint8_t APU::MakeSamples(uint32_t cpuCycle) {
+std::size_t APU::CyclesToEvent() const {
+  float frame = kCpuCyclePerFrame / 4 - frame_cycle_;
+  float sample = kCpuCyclePerFrameSegment - sample_cycle_;
+  // Truncated, an early estimate only costs an extra catch-up
+  return std::max<std::size_t>(1, std::min(frame, sample));
+}
+
+void APU::RunChannels(std::size_t cycle) {
+  if (cycle <= channel_cycle_) return;
+
+  const uint32_t time = channel_cycle_;
+  const uint32_t end = cycle;
+  channel_cycle_ = cycle;
+  if (!audio_enabled_) {
+    // Only the DMC reads memory and raises interrupts
+    dmc_channel_.Run(time, end, changes_[4]);
+    changes_[4].clear();
+    return;
+  }
+
+  pulses_[0].Run(time, end, changes_[0]);
+  pulses_[1].Run(time, end, changes_[1]);
+  triangle_.Run(time, end, changes_[2]);
+  noise_.Run(time, end, changes_[3]);
+  dmc_channel_.Run(time, end, changes_[4]);
+
+  // The mixer is not linear, so the changes of all the channels are merged
+  // in time order
+  std::size_t next[kChannelCount] = {};
+  while (true) {
+    uint32_t t = end + 1;
+    for (int i = 0; i < kChannelCount; ++i) {
+      if (next[i] < changes_[i].size()) {
+        t = std::min(t, changes_[i][next[i]].time);
+      }
+    }
+    if (t > end) break;
+
+    for (int i = 0; i < kChannelCount; ++i) {
+      auto &changes = changes_[i];
+      while (next[i] < changes.size() && changes[next[i]].time == t) {
+        levels_[i] = changes[next[i]++].level;
+      }
+    }
+    MixLevels(t);
+  }
+
+  for (auto &changes : changes_) {
+    changes.clear();
+  }
+}
+
+void APU::UpdateChannels() {
+  if (!audio_enabled_) return;
+
   pulses_[0].UpdateState();
   pulses_[1].UpdateState();
   triangle_.UpdateState();
   noise_.UpdateState();
-#ifdef APU_MAKE_CYCLE
-  static int remnantsCycle = 0;
-  const uint32_t nSampleSize = (remnantsCycle + cpuCycle) / kCpuCyclePerSample;
-  remnantsCycle = (remnantsCycle + cpuCycle) - nSampleSize * kCpuCyclePerSample;
-#else   // APU_MAKE_CYCLE
-  const uint32_t nSampleSize = 245;
-#endif  // APU_MAKE_CYCLE
-
-  auto &sample = output_samples_;
-  sample.resize(nSampleSize);
-  for (size_t i = 0; i < nSampleSize; i++) {
-    sample[i] = SoundMixer(pulses_[0].MakeSamples(),   // input 1
-                           pulses_[1].MakeSamples(),   // input 2
-                           triangle_.MakeSamples(),    // input 3
-                           noise_.MakeSamples(),       // input 4
-                           dmc_channel_.MakeSamples()  // input 5
-    );
+
+  levels_[0] = pulses_[0].Output();
+  levels_[1] = pulses_[1].Output();
+  levels_[2] = triangle_.Output();
+  levels_[3] = noise_.Output();
+  levels_[4] = dmc_channel_.Output();
+  MixLevels(channel_cycle_);
+}
+
+void APU::MixLevels(std::uint32_t time) {
+  int level = SoundMixer(levels_[0], levels_[1], levels_[2], levels_[3],
+                         levels_[4]);
+  if (level != mix_level_) {
+    blip_.AddDelta(time, level - mix_level_);
+    mix_level_ = level;
   }
+}
 
-  return 0;
+void APU::MakeSamples() {
+  RunChannels(sample_cycle_);
+  channel_cycle_ = 0;
+  if (!audio_enabled_) return;
+
+  blip_.EndFrame(sample_cycle_);
+
+  output_samples_.resize(blip_.samplesAvailable());
+  blip_.ReadSamples(output_samples_.data(), output_samples_.size());
+
+  if (speaker_)
+    speaker_->PushSample(output_samples_.data(), output_samples_.size());
 }
 
 inline void APU::ProcessLengthCounter() {
@@ -243,6 +396,8 @@ inline void APU::ProcessEnvelope() {
 
 void APU::DebugDump() {}
 void APU::Save(std::ostream &os) {
+  RunChannels(sample_cycle_);
+
   Serialize::Write(os, mFrameClock);
   Serialize::Write(os, mFrame5Step);
   Serialize::Write(os, mFrameInterrupt);
@@ -252,11 +407,7 @@ void APU::Save(std::ostream &os) {
   Serialize::Write(os, sample_cycle_);
   Serialize::Write(os, sample_segment_);
 
-  pulses_[0].Save(os);
-  pulses_[1].Save(os);
-  triangle_.Save(os);
-  noise_.Save(os);
-  dmc_channel_.Save(os);
+  SaveChannels(os);
 }
 
 void APU::Restore(std::istream &is) {
@@ -269,11 +420,53 @@ void APU::Restore(std::istream &is) {
   Serialize::Read(is, sample_cycle_);
   Serialize::Read(is, sample_segment_);
 
+  RestoreChannels(is);
+}
+
+void APU::SnapshotTo(StateBuffer &buffer) {
+  RunChannels(sample_cycle_);
+
+  buffer.Put(static_cast<const APUState &>(*this));
+
+  pulses_[0].SnapshotTo(buffer);
+  pulses_[1].SnapshotTo(buffer);
+  triangle_.SnapshotTo(buffer);
+  noise_.SnapshotTo(buffer);
+  dmc_channel_.SnapshotTo(buffer);
+}
+
+void APU::RestoreFrom(StateBuffer &buffer) {
+  buffer.Get(static_cast<APUState &>(*this));
+
+  pulses_[0].RestoreFrom(buffer);
+  pulses_[1].RestoreFrom(buffer);
+  triangle_.RestoreFrom(buffer);
+  noise_.RestoreFrom(buffer);
+  dmc_channel_.RestoreFrom(buffer);
+  ResumeChannels();
+}
+
+void APU::SaveChannels(std::ostream &os) {
+  pulses_[0].Save(os);
+  pulses_[1].Save(os);
+  triangle_.Save(os);
+  noise_.Save(os);
+  dmc_channel_.Save(os);
+}
+
+void APU::RestoreChannels(std::istream &is) {
   pulses_[0].Restore(is);
   pulses_[1].Restore(is);
   triangle_.Restore(is);
   noise_.Restore(is);
   dmc_channel_.Restore(is);
+  ResumeChannels();
+}
+
+void APU::ResumeChannels() {
+  channel_cycle_ = sample_cycle_;
+  UpdateChannels();
+  if (!running_ahead_) blip_.Clear();
 }
 
 }  // namespace hn
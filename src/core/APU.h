@@ -1,46 +1,84 @@
 #pragma once
 
 #include "AudioChannel.h"
+#include "BlipBuffer.h"
 #include "MainBus.h"
 #include "PeripheralDevices.h"
 
 namespace hn {
 
-class APU : public Serialize {
+// Frame counter of the APU, plain data for one-copy snapshots
+struct APUState {
+  uint8_t mFrameClock = 0;
+  uint8_t mFrame5Step = 0;
+  bool mFrameInterrupt = false;
+  bool mIRQDisable = false;
+
+  std::size_t frame_cycle_ = 0;
+  std::size_t sample_cycle_ = 0;
+  std::size_t sample_segment_ = 0;
+};
+
+class APU : public Serialize, private APUState {
  public:
   APU(MainBus &bus);
-  void SetSpeaker(VirtualSpeaker *speaker) { speaker_ = speaker; }
+  // The samples are made at the sample rate of the speaker
+  void SetSpeaker(VirtualSpeaker *speaker);
+  // Without audio no sample is made, only the state the CPU can observe is
+  // kept: length counters, frame and DMC interrupts and DMC reads
+  void SetAudioEnabled(bool enabled);
+  // Frames run ahead and then taken back make no sample, and the samples
+  // made before them are kept through RestoreFrom
+  void SetRunAhead(bool ahead);
+  // Makes ratio times as many samples, to follow the rate of the speaker
+  void SetRateRatio(double ratio) { blip_.SetRatio(ratio); }
   void Reset();
   void Step();
+  void Run(std::size_t cycles);
+
+  // Number of Step calls up to and including the next frame counter clock
+  // or sample batch, never more than that
+  std::size_t CyclesToEvent() const;
 
   void Write(Address address, Byte sampleBuffer);
   Byte Read(Address address);
 
   void ProcessFrameCounter();
 
-  uint8_t MakeSamples(uint32_t cpuCycle);
-
   std::vector<short> output_samples_;
 
   void DebugDump();
 
   virtual void Save(std::ostream &os) override;
   virtual void Restore(std::istream &is) override;
+  virtual void SnapshotTo(StateBuffer &buffer) override;
+  virtual void RestoreFrom(StateBuffer &buffer) override;
 
  private:
-  uint8_t mFrameClock = 0;
-  uint8_t mFrame5Step = 0;
-  bool mFrameInterrupt = false;
-  bool mIRQDisable = false;
-
-  std::size_t frame_cycle_ = 0;
-  std::size_t sample_cycle_ = 0;
-  std::size_t sample_segment_ = 0;
+  // Cycle of the frame segment the channels have run up to
+  std::size_t channel_cycle_ = 0;
+  bool audio_enabled_ = true;
+  bool running_ahead_ = false;
+  bool audio_ahead_ = true;  // audio_enabled_ before running ahead
 
   void ProcessEnvelope();
   void ProcessSweepUnit();
   void ProcessLengthCounter();
 
+  // Runs the channels up to the cycle of the frame segment, mixing the level
+  // changes into the synthesizer
+  void RunChannels(std::size_t cycle);
+  // Takes the channel states changed by a register write or a frame counter
+  // clock, at the current cycle
+  void UpdateChannels();
+  void MixLevels(std::uint32_t time);
+  void MakeSamples();
+
+  void SaveChannels(std::ostream &os);
+  void RestoreChannels(std::istream &is);
+  // Goes on from the channels restored, at the sample cycle
+  void ResumeChannels();
+
   int16_t SoundMixer(Byte pulse1, Byte pulse2, Byte triangle, Byte noise,
                      Byte dmc);
 
@@ -49,6 +87,13 @@ class APU : public Serialize {
   NoiseChannel noise_;
   DMCChannel dmc_channel_;
 
+  // Pulse 1, pulse 2, triangle, noise and DMC
+  static constexpr int kChannelCount = 5;
+  LevelChanges changes_[kChannelCount];
+  Byte levels_[kChannelCount] = {};
+  int mix_level_ = 0;
+  BlipBuffer blip_;
+
   MainBus &bus_;
 
   VirtualSpeaker *speaker_;
@@ -4,11 +4,6 @@
 
 namespace hn {
 
-constexpr float kNtscCPURate = 1789773.0;
-constexpr int kSamplesPerSecond = 44100;
-constexpr int kSamplesPerFRAME = kSamplesPerSecond / 60;
-constexpr float kCpuCyclePerSample = kNtscCPURate / kSamplesPerSecond;
-
 // 长度计数器映射表
 static const uint8_t LENGTH_COUNTER_TABLE[] = {
     0x0A, 0xFE, 0x14, 0x02, 0x28, 0x04, 0x50, 0x06, 0xA0, 0x08, 0x3C,
@@ -86,69 +81,133 @@ void EnvelopedChannel::Restore(std::istream &is) {
   Read(is, ctrl6_);
 }
 
-Byte TriangleChannel::MakeSamples() {
+void EnvelopedChannel::SnapshotTo(StateBuffer &buffer) {
+  AudioChannel::SnapshotTo(buffer);
+  buffer.Put(static_cast<const EnvelopeState &>(*this));
+}
+
+void EnvelopedChannel::RestoreFrom(StateBuffer &buffer) {
+  AudioChannel::RestoreFrom(buffer);
+  buffer.Get(static_cast<EnvelopeState &>(*this));
+}
+
+Byte TriangleChannel::Output() const {
   // static const Byte TRI_SEQ[] = {
   // 15, 14, 13, 12, 11, 10, 9,  8,  7,  6, 5,
   // 4,  3,  2,  1,  0,  0,  1,  2,  3,  4, 5,
   // 6,  7,  8,  9,  10, 11, 12, 13, 14, 15};
-
-  cycle_ += kCpuCyclePerSample;
-  const uint16_t cycle = cycle_ / (period_ + 1);
-  const uint8_t inc = incMask_ & cycle;
-  cycle_ -= cycle * (period_ + 1);
-  seqIndex_ += inc;
-  seqIndex_ &= 31;
-
-  Byte volume = volume_;
   if (seqIndex_ < 16) {
-    volume *= 15 - seqIndex_;
+    return volume_ * (15 - seqIndex_);
   } else {
-    volume *= 0x10 ^ seqIndex_;
+    return volume_ * (0x10 ^ seqIndex_);
   }
+}
 
-  return volume;
+void TriangleChannel::Run(uint32_t time, uint32_t end, LevelChanges &changes) {
+  const uint32_t period = period_ + 1;
+  if (cycle_ >= period) cycle_ = period - 1;
+  const uint32_t total = cycle_ + (end - time);
+
+  // Halted, muted or ultrasonic, the output holds
+  if (!incMask_ || !volume_ || period_ < 2) {
+    if (incMask_) seqIndex_ = (seqIndex_ + total / period) & 31;
+    cycle_ = total % period;
+    return;
+  }
+
+  Byte level = Output();
+  for (uint32_t t = time + period - cycle_; t <= end; t += period) {
+    seqIndex_ = (seqIndex_ + 1) & 31;
+    const Byte output = Output();
+    if (output != level) {
+      changes.push_back({t, output});
+      level = output;
+    }
+  }
+  cycle_ = total % period;
 }
 
-Byte PulseChannel::MakeSamples() {
+Byte PulseChannel::Output() const {
   static const Byte PL_SEQ[4] = {2, 6, 0x1e, 0xf9};
   //{0, 1, 0, 0, 0, 0, 0, 0},
   //{0, 1, 1, 0, 0, 0, 0, 0},
   //{0, 1, 1, 1, 1, 0, 0, 0},
   //{1, 0, 0, 1, 1, 1, 1, 1}};
-  cycle_ += kCpuCyclePerSample * 0.5f;
-  const int cycle = (cycle_ / (period_ + 1));
-  cycle_ -= cycle * (period_ + 1);
-  seqIndex_ += cycle;
-  seqIndex_ &= 7;
   return volume_ * ((PL_SEQ[ctrl_ >> 6] >> seqIndex_) & 1);
 }
 
+void PulseChannel::Run(uint32_t time, uint32_t end, LevelChanges &changes) {
+  // The timer is clocked every other CPU cycle
+  const uint32_t period = 2 * (period_ + 1);
+  if (cycle_ >= period) cycle_ = period - 1;
+  const uint32_t total = cycle_ + (end - time);
+
+  if (!volume_) {
+    seqIndex_ = (seqIndex_ + total / period) & 7;
+    cycle_ = total % period;
+    return;
+  }
+
+  Byte level = Output();
+  for (uint32_t t = time + period - cycle_; t <= end; t += period) {
+    seqIndex_ = (seqIndex_ + 1) & 7;
+    const Byte output = Output();
+    if (output != level) {
+      changes.push_back({t, output});
+      level = output;
+    }
+  }
+  cycle_ = total % period;
+}
+
 static inline uint16_t lfsrChange(uint16_t v, uint8_t c) {
   const uint16_t bit = ((v >> 0) ^ (v >> c)) & 1;
   return (uint16_t)(v >> 1) | (uint16_t)(bit << 14);
 }
 
-uint8_t NoiseChannel::MakeSamples() {
-  cycle_ += kCpuCyclePerSample;
-  while (cycle_ >= period_) {
-    cycle_ -= period_;
-    lfsr_ = lfsrChange(lfsr_, bitsRemaining_);
-  }
-
+uint8_t NoiseChannel::Output() const {
   // 为0输出
   uint8_t mask = lfsr_ & 1;
   --mask;
   return volume_ & mask;
 }
 
-uint8_t DMCChannel::MakeSamples() {
-  clock_ += kCpuCyclePerSample;
-  const uint16_t period = period_;
-  while (clock_ >= period) {
-    clock_ -= period;
-    UpdateDmcBit();
+void NoiseChannel::Run(uint32_t time, uint32_t end, LevelChanges &changes) {
+  const uint32_t period = period_ ? period_ : 1;
+  if (cycle_ >= period) cycle_ = period - 1;
+
+  // The shift register keeps running while muted
+  Byte level = Output();
+  for (uint32_t t = time + period - cycle_; t <= end; t += period) {
+    lfsr_ = lfsrChange(lfsr_, bitsRemaining_);
+    if (!volume_) continue;
+
+    const Byte output = Output();
+    if (output != level) {
+      changes.push_back({t, output});
+      level = output;
+    }
   }
-  return volume_;
+  cycle_ = (cycle_ + (end - time)) % period;
+}
+
+uint8_t DMCChannel::Output() const { return volume_; }
+
+void DMCChannel::Run(uint32_t time, uint32_t end, LevelChanges &changes) {
+  const uint32_t period = period_ ? period_ : 1;
+  if (clock_ >= period) clock_ = period - 1;
+
+  if (enable_) {
+    Byte level = volume_;
+    for (uint32_t t = time + period - clock_; t <= end; t += period) {
+      UpdateDmcBit();
+      if (volume_ != level) {
+        changes.push_back({t, volume_});
+        level = volume_;
+      }
+    }
+  }
+  clock_ = (clock_ + (end - time)) % period;
 }
 
 void DMCChannel::UpdateDmcBit() {
@@ -415,6 +474,14 @@ void AudioChannel::Restore(std::istream &is) {
   Read(is, period_);
 }
 
+void AudioChannel::SnapshotTo(StateBuffer &buffer) {
+  buffer.Put(static_cast<const AudioChannelState &>(*this));
+}
+
+void AudioChannel::RestoreFrom(StateBuffer &buffer) {
+  buffer.Get(static_cast<AudioChannelState &>(*this));
+}
+
 void DMCChannel::Save(std::ostream &os) {
   AudioChannel::Save(os);
 
@@ -445,6 +512,16 @@ void DMCChannel::Restore(std::istream &is) {
   Read(is, interruptFlag_);
 }
 
+void DMCChannel::SnapshotTo(StateBuffer &buffer) {
+  AudioChannel::SnapshotTo(buffer);
+  buffer.Put(static_cast<const DMCState &>(*this));
+}
+
+void DMCChannel::RestoreFrom(StateBuffer &buffer) {
+  AudioChannel::RestoreFrom(buffer);
+  buffer.Get(static_cast<DMCState &>(*this));
+}
+
 void TriangleChannel::Save(std::ostream &os) {
   AudioChannel::Save(os);
 
@@ -469,6 +546,16 @@ void TriangleChannel::Restore(std::istream &is) {
   Read(is, incMask_);
 }
 
+void TriangleChannel::SnapshotTo(StateBuffer &buffer) {
+  AudioChannel::SnapshotTo(buffer);
+  buffer.Put(static_cast<const TriangleState &>(*this));
+}
+
+void TriangleChannel::RestoreFrom(StateBuffer &buffer) {
+  AudioChannel::RestoreFrom(buffer);
+  buffer.Get(static_cast<TriangleState &>(*this));
+}
+
 void NoiseChannel::Save(std::ostream &os) {
   EnvelopedChannel::Save(os);
 
@@ -489,6 +576,16 @@ void NoiseChannel::Restore(std::istream &is) {
   Read(is, periodIndex_);
 }
 
+void NoiseChannel::SnapshotTo(StateBuffer &buffer) {
+  EnvelopedChannel::SnapshotTo(buffer);
+  buffer.Put(static_cast<const NoiseState &>(*this));
+}
+
+void NoiseChannel::RestoreFrom(StateBuffer &buffer) {
+  EnvelopedChannel::RestoreFrom(buffer);
+  buffer.Get(static_cast<NoiseState &>(*this));
+}
+
 void PulseChannel::Save(std::ostream &os) {
   EnvelopedChannel::Save(os);
 
@@ -511,4 +608,14 @@ void PulseChannel::Restore(std::istream &is) {
   Read(is, cycle_);
 }
 
+void PulseChannel::SnapshotTo(StateBuffer &buffer) {
+  EnvelopedChannel::SnapshotTo(buffer);
+  buffer.Put(static_cast<const PulseState &>(*this));
+}
+
+void PulseChannel::RestoreFrom(StateBuffer &buffer) {
+  EnvelopedChannel::RestoreFrom(buffer);
+  buffer.Get(static_cast<PulseState &>(*this));
+}
+
 }  // namespace hn
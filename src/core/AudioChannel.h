@@ -1,14 +1,36 @@
 #pragma once
 
+#include <vector>
+
 #include "MainBus.h"
 #include "common.h"
 
 namespace hn {
-class AudioChannel : public Serialize {
+// Output level of a channel from CPU cycle `time` of the APU frame segment
+struct LevelChange {
+  std::uint32_t time;
+  Byte level;
+};
+using LevelChanges = std::vector<LevelChange>;
+
+// The registers of the channels are kept in plain data bases, apart from
+// their classes, for one-copy snapshots
+struct AudioChannelState {
+  bool enable_;
+  Byte volume_;
+  Byte lengthCounter_;
+  uint16_t period_;
+};
+
+class AudioChannel : public Serialize, public AudioChannelState {
  public:
   AudioChannel() {}
 
-  virtual Byte MakeSamples() = 0;
+  // Runs the CPU cycles after `time` up to and including `end`, adding every
+  // change of the output level to changes
+  virtual void Run(std::uint32_t time, std::uint32_t end,
+                   LevelChanges &changes) = 0;
+  virtual Byte Output() const = 0;
   virtual void ProcessLengthCounter() {}
   virtual void UpdateState() {}
   virtual void WriteControl(Address address, Byte data) = 0;
@@ -17,44 +39,50 @@ class AudioChannel : public Serialize {
 
   virtual void Save(std::ostream &os) override;
   virtual void Restore(std::istream &is) override;
-
-  bool enable_;
-  Byte volume_;
-  Byte lengthCounter_;
-  uint16_t period_;
+  virtual void SnapshotTo(StateBuffer &buffer) override;
+  virtual void RestoreFrom(StateBuffer &buffer) override;
 };
 
-struct EnvelopedChannel : public AudioChannel {
+struct EnvelopeState {
   bool start_flag_;  //是否重载
   uint8_t divider_;  // 时钟分频器
   uint8_t decay_;    // 计数器
   uint8_t ctrl6_;    // 控制器低6位
+};
 
+struct EnvelopedChannel : public AudioChannel, public EnvelopeState {
   virtual void Save(std::ostream &os) override;
   virtual void Restore(std::istream &is) override;
+  virtual void SnapshotTo(StateBuffer &buffer) override;
+  virtual void RestoreFrom(StateBuffer &buffer) override;
 
   void ProcessEnvelope();
 };
 
-struct NoiseChannel : public EnvelopedChannel {
-  // EnvelopedChannel
+struct NoiseState {
   uint32_t cycle_;
   uint8_t bitsRemaining_;
   uint16_t lfsr_;        // 线性反馈移位寄存器
   uint8_t shortMode_;    // 短模式D7
   uint8_t periodIndex_;  //周期索引 D0~D3
+};
 
-  virtual Byte MakeSamples() override;
+struct NoiseChannel : public EnvelopedChannel, public NoiseState {
+  virtual void Run(std::uint32_t time, std::uint32_t end,
+                   LevelChanges &changes) override;
+  virtual Byte Output() const override;
   virtual void ProcessLengthCounter() override;
   virtual void UpdateState() override;
   virtual void WriteControl(Address address, Byte data) override;
 
   virtual void Save(std::ostream &os) override;
   virtual void Restore(std::istream &is) override;
+  virtual void SnapshotTo(StateBuffer &buffer) override;
+  virtual void RestoreFrom(StateBuffer &buffer) override;
 };
 
 /// DMC
-struct DMCChannel : public AudioChannel {
+struct DMCState {
   Address orgaddr_;          // 原始地址
   Address address_;          // 当前地址
   uint16_t length_;          // 原始长度
@@ -65,10 +93,14 @@ struct DMCChannel : public AudioChannel {
   uint8_t bitsRemaining_;    // 8步计数
   uint8_t sampleBuffer_;     // 字节数据[8字节位移寄存器]
   uint8_t interruptFlag_;    // 字节数据[8字节位移寄存器]
+};
 
+struct DMCChannel : public AudioChannel, public DMCState {
   DMCChannel(MainBus &bus) : bus_(bus) {}
 
-  virtual Byte MakeSamples() override;
+  virtual void Run(std::uint32_t time, std::uint32_t end,
+                   LevelChanges &changes) override;
+  virtual Byte Output() const override;
   virtual void WriteControl(Address address, Byte data) override;
   virtual void setEnable(bool enable) override;
   // virtual void ProcessLengthCounter() override;
@@ -76,6 +108,8 @@ struct DMCChannel : public AudioChannel {
 
   virtual void Save(std::ostream &os) override;
   virtual void Restore(std::istream &is) override;
+  virtual void SnapshotTo(StateBuffer &buffer) override;
+  virtual void RestoreFrom(StateBuffer &buffer) override;
 
   void UpdateDmcBit();
   void Reset();
@@ -84,7 +118,7 @@ struct DMCChannel : public AudioChannel {
 };
 
 // Triangle wave
-struct TriangleChannel : public AudioChannel {
+struct TriangleState {
   uint32_t cycle_;
   uint8_t linearCounter_;
   uint8_t reloadValue_;
@@ -92,8 +126,12 @@ struct TriangleChannel : public AudioChannel {
   uint8_t flagHalt_;
   uint8_t seqIndex_;  // Current sequence index
   uint8_t incMask_;   // Volume
+};
 
-  virtual Byte MakeSamples() override;
+struct TriangleChannel : public AudioChannel, public TriangleState {
+  virtual void Run(std::uint32_t time, std::uint32_t end,
+                   LevelChanges &changes) override;
+  virtual Byte Output() const override;
   virtual void ProcessLengthCounter() override;
   virtual void UpdateState() override;
   virtual void WriteControl(Address address, Byte data) override;
@@ -102,13 +140,14 @@ struct TriangleChannel : public AudioChannel {
 
   virtual void Save(std::ostream &os) override;
   virtual void Restore(std::istream &is) override;
+  virtual void SnapshotTo(StateBuffer &buffer) override;
+  virtual void RestoreFrom(StateBuffer &buffer) override;
 
   void ProcessLinearCounter();
 };
 
 // Pulse square wave
-struct PulseChannel : public EnvelopedChannel {
-  // EnvelopedChannel
+struct PulseState {
   //$4001/$4005 EPPPNSSS
 
   /// Linear sweep unit
@@ -130,14 +169,20 @@ struct PulseChannel : public EnvelopedChannel {
   uint8_t ctrl_;      //占空比 D
   uint8_t seqIndex_;  //序列索引
   uint32_t cycle_;
+};
 
-  virtual Byte MakeSamples() override;
+struct PulseChannel : public EnvelopedChannel, public PulseState {
+  virtual void Run(std::uint32_t time, std::uint32_t end,
+                   LevelChanges &changes) override;
+  virtual Byte Output() const override;
   virtual void ProcessLengthCounter() override;
   virtual void UpdateState() override;
   virtual void WriteControl(Address address, Byte data) override;
 
   virtual void Save(std::ostream &os) override;
   virtual void Restore(std::istream &is) override;
+  virtual void SnapshotTo(StateBuffer &buffer) override;
+  virtual void RestoreFrom(StateBuffer &buffer) override;
 
   void ProcessSweepUnit(bool isOne);
 };
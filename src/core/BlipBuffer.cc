@@ -0,0 +1,87 @@
+#include "BlipBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace hn {
+constexpr double kPi = 3.14159265358979323846;
+// Cutoff of the low-pass, in sample rates
+constexpr double kCutoff = 0.45;
+
+BlipBuffer::BlipBuffer() : factor_(0), offset_(0), integrator_(0) {
+  // Windowed sinc impulses, delayed by half the taps so that no change
+  // touches a sample before its own
+  for (int phase = 0; phase < kPhases; ++phase) {
+    double impulse[kTaps];
+    double sum = 0;
+    for (int i = 0; i < kTaps; ++i) {
+      double x = i - (kTaps / 2 - 1) - double(phase) / kPhases;
+      double sinc = x ? std::sin(2 * kPi * kCutoff * x) / (kPi * x)
+                      : 2 * kCutoff;
+      double window = 0.42 + 0.5 * std::cos(kPi * x / (kTaps / 2)) +
+                      0.08 * std::cos(2 * kPi * x / (kTaps / 2));
+      impulse[i] = sinc * window;
+      sum += impulse[i];
+    }
+
+    // Every step must add up to exactly one, or a DC offset builds up
+    int total = 0;
+    for (int i = 0; i < kTaps; ++i) {
+      kernels_[phase][i] =
+          static_cast<int>(std::lround(impulse[i] / sum * (1 << kKernelBits)));
+      total += kernels_[phase][i];
+    }
+    kernels_[phase][kTaps / 2 - 1] += (1 << kKernelBits) - total;
+  }
+
+  SetRates(1789773.0, 44100);
+}
+
+void BlipBuffer::SetRates(double clock_rate, unsigned int sample_rate) {
+  rate_ = sample_rate / clock_rate;
+  SetRatio(1);
+  buffer_.assign(sample_rate / 10 + kTaps, 0);
+  Clear();
+}
+
+void BlipBuffer::SetRatio(double ratio) {
+  factor_ = static_cast<std::uint64_t>(
+      std::ceil(rate_ * ratio * (std::uint64_t(1) << kFracBits)));
+}
+
+void BlipBuffer::Clear() {
+  std::fill(buffer_.begin(), buffer_.end(), 0);
+  offset_ = 0;
+  integrator_ = 0;
+}
+
+void BlipBuffer::EndFrame(std::uint32_t clocks) {
+  offset_ += clocks * factor_;
+}
+
+std::size_t BlipBuffer::ReadSamples(std::int16_t *out, std::size_t count) {
+  count = std::min(count, samplesAvailable());
+
+  for (std::size_t i = 0; i < count; ++i) {
+    // Leaky integration, the steps decay slowly towards zero
+    integrator_ += buffer_[i] - (integrator_ >> kBassShift);
+    int sample = integrator_ >> kKernelBits;
+    if (sample > std::numeric_limits<std::int16_t>::max())
+      sample = std::numeric_limits<std::int16_t>::max();
+    else if (sample < std::numeric_limits<std::int16_t>::min())
+      sample = std::numeric_limits<std::int16_t>::min();
+    out[i] = static_cast<std::int16_t>(sample);
+  }
+
+  // Keep the changes already added past the samples read
+  std::size_t remain = samplesAvailable() - count + kTaps;
+  std::copy(buffer_.begin() + count, buffer_.begin() + count + remain,
+            buffer_.begin());
+  std::fill(buffer_.begin() + remain, buffer_.begin() + count + remain, 0);
+  offset_ -= std::uint64_t(count) << kFracBits;
+
+  return count;
+}
+
+}  // namespace hn
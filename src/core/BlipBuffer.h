@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace hn {
+
+// Band-limited synthesis of a signal given as its amplitude changes at clock
+// times. Every change adds a band-limited step, the samples are produced in
+// a single pass at the output rate.
+//
+//  http://www.slack.net/~ant/bl-synth/
+//
+class BlipBuffer {
+ public:
+  BlipBuffer();
+
+  // Frames must not run longer than 100 ms of samples
+  void SetRates(double clock_rate, unsigned int sample_rate);
+  // Bends the sample rate by the ratio, close to 1, keeping the samples
+  void SetRatio(double ratio);
+  void Clear();
+
+  // Changes the amplitude by delta at the clock time of the current frame
+  void AddDelta(std::uint32_t time, int delta) {
+    std::uint64_t position = offset_ + time * factor_;
+    std::size_t index = position >> kFracBits;
+    if (index + kTaps > buffer_.size()) return;
+
+    const int *kernel =
+        kernels_[(position >> (kFracBits - kPhaseBits)) & (kPhases - 1)];
+    std::int32_t *out = &buffer_[index];
+    for (int i = 0; i < kTaps; ++i) {
+      out[i] += kernel[i] * delta;
+    }
+  }
+
+  // Ends the current frame after the clocks, its samples may be read then
+  void EndFrame(std::uint32_t clocks);
+
+  std::size_t samplesAvailable() const { return offset_ >> kFracBits; }
+  std::size_t ReadSamples(std::int16_t *out, std::size_t count);
+
+ private:
+  static constexpr int kFracBits = 32;
+  static constexpr int kPhaseBits = 6;
+  static constexpr int kPhases = 1 << kPhaseBits;
+  static constexpr int kTaps = 16;
+  static constexpr int kKernelBits = 12;  // fraction bits of the kernels
+  static constexpr int kBassShift = 9;    // high-pass, about 14Hz at 44100Hz
+
+  // Integral step responses for each fraction of a sample
+  int kernels_[kPhases][kTaps];
+
+  std::vector<std::int32_t> buffer_;
+  double rate_;           // samples per clock, unbent
+  std::uint64_t factor_;  // samples per clock
+  std::uint64_t offset_;  // samples from the buffer start to the frame start
+  std::int32_t integrator_;
+};
+
+}  // namespace hn
@@ -108,6 +108,18 @@ void CPU::skipDMACycles() {
   skipCycles_ += (cycles_ & 1);  //+1 if on odd cycle
 }
 
+int CPU::StepInstruction() {
+  int idle = idle_cycles();
+  Idle(idle);
+  Step();
+  return idle + 1;
+}
+
+void CPU::Idle(int cycles) {
+  cycles_ += cycles;
+  skipCycles_ -= cycles;
+}
+
 void CPU::Step() {
   ++cycles_;
 
@@ -148,15 +160,11 @@ void CPU::Step() {
 
   old_PC_ = reg_PC_;
   Byte opcode = bus_.read(reg_PC_++);
-  auto CycleLength = OperationCycles[opcode];
-
-  // Using short-circuit evaluation, call the other function only if the first
-  // failed ExecuteImplied must be called first and ExecuteBranch must be before
-  // ExecuteType0
-  if (CycleLength &&
-      (executeImplied(opcode) || executeBranch(opcode) ||
-       executeType1(opcode) || executeType2(opcode) || executeType0(opcode))) {
-    skipCycles_ += CycleLength;
+  OpcodeHandler handler = kOpcodeTable[opcode];
+
+  if (handler) {
+    (this->*handler)();
+    skipCycles_ += OperationCycles[opcode];
     // cycles_ %= 340; //compatibility with Nintendulator log
     // skipCycles_ = 0; //for TESTING
   } else {
@@ -166,8 +174,9 @@ void CPU::Step() {
   }
 }
 
-bool CPU::executeImplied(Byte opcode) {
-  switch (static_cast<OperationImplied>(opcode)) {
+template <OperationImplied op>
+void CPU::executeImplied() {
+  switch (op) {
     case NOP:
       break;
     case BRK:
@@ -319,42 +328,31 @@ bool CPU::executeImplied(Byte opcode) {
       reg_X_ = reg_SP_;
       setZN(reg_X_);
       break;
-    default:
-      return false;
   };
-  return true;
 }
 
-bool CPU::executeBranch(Byte opcode) {
-  if (OPNOTBRANCH(opcode)) {
-    return false;
-  }
-
-  // branch is initialized to the condition required (for the flag specified
-  // later)
-  bool branch = opcode & BranchConditionMask;
-
+template <BranchOnFlag flag, bool cond>
+void CPU::executeBranch() {
   // set branch to true if the given condition is met by the given flag
   // We use xnor here, it is true if either both operands are true or false
-  switch (opcode >> BranchOnFlagShift) {
+  bool branch = false;
+  switch (flag) {
     case Negative:
       // JL / JNL
-      branch = !(branch ^ gFlag(N));
+      branch = !(cond ^ gFlag(N));
       break;
     case Overflow:
       // JO / JNO
-      branch = !(branch ^ gFlag(V));
+      branch = !(cond ^ gFlag(V));
       break;
     case Carry:
       // JC / JNC
-      branch = !(branch ^ gFlag(C));
+      branch = !(cond ^ gFlag(C));
       break;
     case Zero:
       // JZ / JNZ
-      branch = !(branch ^ gFlag(Z));
+      branch = !(cond ^ gFlag(Z));
       break;
-    default:
-      return false;
   }
 
   if (branch) {
@@ -366,18 +364,12 @@ bool CPU::executeBranch(Byte opcode) {
   } else {
     ++reg_PC_;
   }
-
-  return true;
 }
 
-bool CPU::executeType1(Byte opcode) {
-  if (OPNOTTYPE(opcode, 0x1)) {
-    return false;
-  }
-
+template <AddrMode1 mode, Operation1 op>
+void CPU::executeType1() {
   Address location = 0;  // Location of the operand, could be in RAM
-  auto op = OPACTION(opcode, 1);
-  switch (OPADDRMODE(opcode, 1)) {
+  switch (mode) {
     case IndexedIndirectX: {
       Byte zero_addr = reg_X_ + bus_.read(reg_PC_++);
       // Addresses wrap in zero page mode, thus pass through a mask
@@ -417,8 +409,6 @@ bool CPU::executeType1(Byte opcode) {
       if (op != STA) setPageCrossed(location, location + reg_X_);
       location += reg_X_;
       break;
-    default:
-      return false;
   }
 
   switch (op) {
@@ -472,22 +462,15 @@ bool CPU::executeType1(Byte opcode) {
       sFlag(!(diff & 0x100), C);
       setZN(diff);
     } break;
-    default:
-      return false;
   }
-
-  return true;
 }
 
-bool CPU::executeType2(Byte opcode) {
-  if (OPNOTTYPE(opcode, 0x2)) {
-    return false;
-  }
-
+template <AddrMode2 mode, Operation2 op>
+void CPU::executeType2() {
   Address location = 0;
-  auto op = OPACTION(opcode, 2);
-  auto addr_mode = OPADDRMODE(opcode, 2);
-  switch (addr_mode) {
+  // LDX and STX index with Y instead of X
+  const bool index_y = (op == LDX || op == STX);
+  switch (mode) {
     case Immediate_:
       location = reg_PC_++;
       break;
@@ -502,36 +485,24 @@ bool CPU::executeType2(Byte opcode) {
       break;
     case Indexed: {
       location = bus_.read(reg_PC_++);
-      Byte index;
-      if (op == LDX || op == STX) {
-        index = reg_Y_;
-      } else {
-        index = reg_X_;
-      }
+      Byte index = index_y ? reg_Y_ : reg_X_;
       // The mask wraps address around zero page
       location = (location + index) & 0xff;
     } break;
     case AbsoluteIndexed: {
       location = readAddress(reg_PC_);
       reg_PC_ += 2;
-      Byte index;
-      if (op == LDX || op == STX) {
-        index = reg_Y_;
-      } else {
-        index = reg_X_;
-      }
+      Byte index = index_y ? reg_Y_ : reg_X_;
       setPageCrossed(location, location + index);
       location += index;
     } break;
-    default:
-      return false;
   }
 
   std::uint16_t operand = 0;
   switch (op) {
     case ASL:
     case ROL:
-      if (addr_mode == Accumulator) {
+      if (mode == Accumulator) {
         bool prev_C = gFlag(C);
         sFlag(reg_A_ & 0x80, C);
         reg_A_ <<= 1;
@@ -549,7 +520,7 @@ bool CPU::executeType2(Byte opcode) {
       break;
     case LSR:
     case ROR:
-      if (addr_mode == Accumulator) {
+      if (mode == Accumulator) {
         bool prev_C = gFlag(C);
         sFlag(reg_A_ & 1, C);
         reg_A_ >>= 1;
@@ -582,21 +553,13 @@ bool CPU::executeType2(Byte opcode) {
       setZN(tmp);
       bus_.write(location, tmp);
     } break;
-    default:
-      LOG(ERROR) << "Unrecognized opcode:" << std::hex << int(op)
-                 << " @pc: " << reg_PC_;
-      return false;
   }
-  return true;
 }
 
-bool CPU::executeType0(Byte opcode) {
-  if (OPNOTTYPE(opcode, 0x0)) {
-    return false;
-  }
-
+template <AddrMode2 mode, Operation0 op>
+void CPU::executeType0() {
   Address location = 0;
-  switch (OPADDRMODE(opcode, 2)) {
+  switch (mode) {
     case Immediate_:
       location = reg_PC_++;
       break;
@@ -618,10 +581,10 @@ bool CPU::executeType0(Byte opcode) {
       location += reg_X_;
       break;
     default:
-      return false;
+      break;
   }
   std::uint16_t operand = 0;
-  switch (OPACTION(opcode, 0)) {
+  switch (op) {
     case BIT:
       operand = bus_.read(location);
       sFlag(!(reg_A_ & operand), Z);
@@ -645,13 +608,157 @@ bool CPU::executeType0(Byte opcode) {
       sFlag(!(diff & 0x100), C);
       setZN(diff);
     } break;
-    default:
-      return false;
   }
-
-  return true;
 }
 
+#define IMP(op) &CPU::executeImplied<op>
+#define BRA(flag, cond) &CPU::executeBranch<flag, cond>
+#define OP1(mode, op) &CPU::executeType1<mode, op>
+#define OP2(mode, op) &CPU::executeType2<mode, op>
+#define OP0(mode, op) &CPU::executeType0<mode, op>
+#define ___ nullptr
+
+// Indexed by opcode, nullptr implies unused opcode. Each entry is specialized
+// on its addressing mode and operation, so Step dispatches with one indirect
+// call instead of re-decoding the opcode.
+const CPU::OpcodeHandler CPU::kOpcodeTable[0x100] = {
+    /* 00 */ IMP(BRK), OP1(IndexedIndirectX, ORA),
+    /* 02 */ ___, ___,
+    /* 04 */ ___, OP1(ZeroPage, ORA),
+    /* 06 */ OP2(ZeroPage_, ASL), ___,
+    /* 08 */ IMP(PHP), OP1(Immediate, ORA),
+    /* 0A */ OP2(Accumulator, ASL), ___,
+    /* 0C */ ___, OP1(Absolute, ORA),
+    /* 0E */ OP2(Absolute_, ASL), ___,
+    /* 10 */ BRA(Negative, false), OP1(IndirectY, ORA),
+    /* 12 */ ___, ___,
+    /* 14 */ ___, OP1(IndexedX, ORA),
+    /* 16 */ OP2(Indexed, ASL), ___,
+    /* 18 */ IMP(CLC), OP1(AbsoluteY, ORA),
+    /* 1A */ ___, ___,
+    /* 1C */ ___, OP1(AbsoluteX, ORA),
+    /* 1E */ OP2(AbsoluteIndexed, ASL), ___,
+    /* 20 */ IMP(JSR), OP1(IndexedIndirectX, AND),
+    /* 22 */ ___, ___,
+    /* 24 */ OP0(ZeroPage_, BIT), OP1(ZeroPage, AND),
+    /* 26 */ OP2(ZeroPage_, ROL), ___,
+    /* 28 */ IMP(PLP), OP1(Immediate, AND),
+    /* 2A */ OP2(Accumulator, ROL), ___,
+    /* 2C */ OP0(Absolute_, BIT), OP1(Absolute, AND),
+    /* 2E */ OP2(Absolute_, ROL), ___,
+    /* 30 */ BRA(Negative, true), OP1(IndirectY, AND),
+    /* 32 */ ___, ___,
+    /* 34 */ ___, OP1(IndexedX, AND),
+    /* 36 */ OP2(Indexed, ROL), ___,
+    /* 38 */ IMP(SEC), OP1(AbsoluteY, AND),
+    /* 3A */ ___, ___,
+    /* 3C */ ___, OP1(AbsoluteX, AND),
+    /* 3E */ OP2(AbsoluteIndexed, ROL), ___,
+    /* 40 */ IMP(RTI), OP1(IndexedIndirectX, EOR),
+    /* 42 */ ___, ___,
+    /* 44 */ ___, OP1(ZeroPage, EOR),
+    /* 46 */ OP2(ZeroPage_, LSR), ___,
+    /* 48 */ IMP(PHA), OP1(Immediate, EOR),
+    /* 4A */ OP2(Accumulator, LSR), ___,
+    /* 4C */ IMP(JMP), OP1(Absolute, EOR),
+    /* 4E */ OP2(Absolute_, LSR), ___,
+    /* 50 */ BRA(Overflow, false), OP1(IndirectY, EOR),
+    /* 52 */ ___, ___,
+    /* 54 */ ___, OP1(IndexedX, EOR),
+    /* 56 */ OP2(Indexed, LSR), ___,
+    /* 58 */ IMP(CLI), OP1(AbsoluteY, EOR),
+    /* 5A */ ___, ___,
+    /* 5C */ ___, OP1(AbsoluteX, EOR),
+    /* 5E */ OP2(AbsoluteIndexed, LSR), ___,
+    /* 60 */ IMP(RTS), OP1(IndexedIndirectX, ADC),
+    /* 62 */ ___, ___,
+    /* 64 */ ___, OP1(ZeroPage, ADC),
+    /* 66 */ OP2(ZeroPage_, ROR), ___,
+    /* 68 */ IMP(PLA), OP1(Immediate, ADC),
+    /* 6A */ OP2(Accumulator, ROR), ___,
+    /* 6C */ IMP(JMPI), OP1(Absolute, ADC),
+    /* 6E */ OP2(Absolute_, ROR), ___,
+    /* 70 */ BRA(Overflow, true), OP1(IndirectY, ADC),
+    /* 72 */ ___, ___,
+    /* 74 */ ___, OP1(IndexedX, ADC),
+    /* 76 */ OP2(Indexed, ROR), ___,
+    /* 78 */ IMP(SEI), OP1(AbsoluteY, ADC),
+    /* 7A */ ___, ___,
+    /* 7C */ ___, OP1(AbsoluteX, ADC),
+    /* 7E */ OP2(AbsoluteIndexed, ROR), ___,
+    /* 80 */ ___, OP1(IndexedIndirectX, STA),
+    /* 82 */ ___, ___,
+    /* 84 */ OP0(ZeroPage_, STY), OP1(ZeroPage, STA),
+    /* 86 */ OP2(ZeroPage_, STX), ___,
+    /* 88 */ IMP(DEY), ___,
+    /* 8A */ IMP(TXA), ___,
+    /* 8C */ OP0(Absolute_, STY), OP1(Absolute, STA),
+    /* 8E */ OP2(Absolute_, STX), ___,
+    /* 90 */ BRA(Carry, false), OP1(IndirectY, STA),
+    /* 92 */ ___, ___,
+    /* 94 */ OP0(Indexed, STY), OP1(IndexedX, STA),
+    /* 96 */ OP2(Indexed, STX), ___,
+    /* 98 */ IMP(TYA), OP1(AbsoluteY, STA),
+    /* 9A */ IMP(TXS), ___,
+    /* 9C */ ___, OP1(AbsoluteX, STA),
+    /* 9E */ ___, ___,
+    /* A0 */ OP0(Immediate_, LDY), OP1(IndexedIndirectX, LDA),
+    /* A2 */ OP2(Immediate_, LDX), ___,
+    /* A4 */ OP0(ZeroPage_, LDY), OP1(ZeroPage, LDA),
+    /* A6 */ OP2(ZeroPage_, LDX), ___,
+    /* A8 */ IMP(TAY), OP1(Immediate, LDA),
+    /* AA */ IMP(TAX), ___,
+    /* AC */ OP0(Absolute_, LDY), OP1(Absolute, LDA),
+    /* AE */ OP2(Absolute_, LDX), ___,
+    /* B0 */ BRA(Carry, true), OP1(IndirectY, LDA),
+    /* B2 */ ___, ___,
+    /* B4 */ OP0(Indexed, LDY), OP1(IndexedX, LDA),
+    /* B6 */ OP2(Indexed, LDX), ___,
+    /* B8 */ IMP(CLV), OP1(AbsoluteY, LDA),
+    /* BA */ IMP(TSX), ___,
+    /* BC */ OP0(AbsoluteIndexed, LDY), OP1(AbsoluteX, LDA),
+    /* BE */ OP2(AbsoluteIndexed, LDX), ___,
+    /* C0 */ OP0(Immediate_, CPY), OP1(IndexedIndirectX, CMP),
+    /* C2 */ ___, ___,
+    /* C4 */ OP0(ZeroPage_, CPY), OP1(ZeroPage, CMP),
+    /* C6 */ OP2(ZeroPage_, DEC), ___,
+    /* C8 */ IMP(INY), OP1(Immediate, CMP),
+    /* CA */ IMP(DEX), ___,
+    /* CC */ OP0(Absolute_, CPY), OP1(Absolute, CMP),
+    /* CE */ OP2(Absolute_, DEC), ___,
+    /* D0 */ BRA(Zero, false), OP1(IndirectY, CMP),
+    /* D2 */ ___, ___,
+    /* D4 */ ___, OP1(IndexedX, CMP),
+    /* D6 */ OP2(Indexed, DEC), ___,
+    /* D8 */ IMP(CLD), OP1(AbsoluteY, CMP),
+    /* DA */ ___, ___,
+    /* DC */ ___, OP1(AbsoluteX, CMP),
+    /* DE */ OP2(AbsoluteIndexed, DEC), ___,
+    /* E0 */ OP0(Immediate_, CPX), OP1(IndexedIndirectX, SBC),
+    /* E2 */ ___, ___,
+    /* E4 */ OP0(ZeroPage_, CPX), OP1(ZeroPage, SBC),
+    /* E6 */ OP2(ZeroPage_, INC), ___,
+    /* E8 */ IMP(INX), OP1(Immediate, SBC),
+    /* EA */ IMP(NOP), ___,
+    /* EC */ OP0(Absolute_, CPX), OP1(Absolute, SBC),
+    /* EE */ OP2(Absolute_, INC), ___,
+    /* F0 */ BRA(Zero, true), OP1(IndirectY, SBC),
+    /* F2 */ ___, ___,
+    /* F4 */ ___, OP1(IndexedX, SBC),
+    /* F6 */ OP2(Indexed, INC), ___,
+    /* F8 */ IMP(SED), OP1(AbsoluteY, SBC),
+    /* FA */ ___, ___,
+    /* FC */ ___, OP1(AbsoluteX, SBC),
+    /* FE */ OP2(AbsoluteIndexed, INC), ___,
+};
+
+#undef IMP
+#undef BRA
+#undef OP1
+#undef OP2
+#undef OP0
+#undef ___
+
 Address CPU::readAddress(Address addr) { return bus_.readAddress(addr); }
 
 void CPU::DebugDump() {
@@ -757,4 +864,27 @@ void CPU::Restore(std::istream& is) {
 
   Read(is, irq_flag_);
 }
+
+void CPU::SnapshotTo(StateBuffer& buffer) {
+  buffer.Put(static_cast<const CPUState&>(*this));
+}
+
+void CPU::RestoreFrom(StateBuffer& buffer) {
+  buffer.Get(static_cast<CPUState&>(*this));
+}
+
+void CPU::Hash(StateHash& hash) const {
+  hash.Add(reg_PC_);
+  hash.Add(reg_SP_);
+  hash.Add(reg_A_);
+  hash.Add(reg_X_);
+  hash.Add(reg_Y_);
+#ifdef PSW_IN_BYTE
+  hash.Add(psw_);
+#else   // PSW_IN_BYTE
+  for (bool flag : {flag_C_, flag_Z_, flag_I_, flag_D_, flag_V_, flag_N_}) {
+    hash.Add(flag);
+  }
+#endif  // PSW_IN_BYTE
+}
 };  // namespace hn
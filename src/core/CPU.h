@@ -6,11 +6,46 @@
 
 namespace hn {
 
-class CPU : public Serialize {
+// Registers and counters of the CPU, plain data for one-copy snapshots
+struct CPUState {
+  int skipCycles_;
+  int cycles_;
+
+  // Registers
+  Address reg_PC_;
+  Address old_PC_;
+  Byte reg_SP_;
+  Byte reg_A_;
+  Byte reg_X_;
+  Byte reg_Y_;
+
+  // Status flags.
+#ifdef PSW_IN_BYTE
+  Byte psw_;
+#else   // PSW_IN_BYTE
+  // Is storing them in one byte better?
+  bool flag_C_;
+  bool flag_Z_;
+  bool flag_I_;
+  // bool flag_B_;
+  bool flag_D_;
+  bool flag_V_;
+  bool flag_N_;
+#endif  // PSW_IN_BYTE
+
+  Byte irq_flag_;
+};
+
+class CPU : public Serialize, private CPUState {
  public:
   CPU(MainBus& mem);
 
   void Step();
+  // Runs the idle cycles left from the last instruction plus the next one,
+  // same as calling Step that many times. Returns the cycles consumed.
+  int StepInstruction();
+  // Consumes cycles that are known to be idle, at most idle_cycles().
+  void Idle(int cycles);
   void Reset();
   void Reset(Address start_addr);
 
@@ -21,24 +56,38 @@ class CPU : public Serialize {
   void TryNMI() { SET_BIT(irq_flag_, IT_NMI); }
 
   size_t clock_cycles() const { return cycles_; }
+  // Cycles that Step will spend before executing the next instruction
+  int idle_cycles() const { return skipCycles_ > 1 ? skipCycles_ - 1 : 0; }
 
   void DebugDump();
 
   virtual void Save(std::ostream& os) override;
   virtual void Restore(std::istream& is) override;
+  virtual void SnapshotTo(StateBuffer& buffer) override;
+  virtual void RestoreFrom(StateBuffer& buffer) override;
+  // Registers and flags, leaving out the cycle counters
+  void Hash(StateHash& hash) const;
 
  private:
   // Assuming sequential execution, for asynchronously calling this with
   // Execute, further work needed
   void interrupt(InterruptType type);
 
-  // Instructions are split into five sets to make decoding easier.
-  // These functions return true if they succeed
-  bool executeImplied(Byte opcode);
-  bool executeBranch(Byte opcode);
-  bool executeType0(Byte opcode);
-  bool executeType1(Byte opcode);
-  bool executeType2(Byte opcode);
+  // Instructions are split into five sets to make decoding easier. Every
+  // opcode is bound to a specialization of one of them in kOpcodeTable.
+  template <OperationImplied op>
+  void executeImplied();
+  template <BranchOnFlag flag, bool cond>
+  void executeBranch();
+  template <AddrMode2 mode, Operation0 op>
+  void executeType0();
+  template <AddrMode1 mode, Operation1 op>
+  void executeType1();
+  template <AddrMode2 mode, Operation2 op>
+  void executeType2();
+
+  typedef void (CPU::*OpcodeHandler)();
+  static const OpcodeHandler kOpcodeTable[0x100];
 
   Address readAddress(Address addr);
 
@@ -64,33 +113,6 @@ class CPU : public Serialize {
   }
 #endif  // PSW_IN_BYTE
 
-  int skipCycles_;
-  int cycles_;
-
-  // Registers
-  Address reg_PC_;
-  Address old_PC_;
-  Byte reg_SP_;
-  Byte reg_A_;
-  Byte reg_X_;
-  Byte reg_Y_;
-
-  // Status flags.
-#ifdef PSW_IN_BYTE
-  Byte psw_;
-#else   // PSW_IN_BYTE
-  // Is storing them in one byte better?
-  bool flag_C_;
-  bool flag_Z_;
-  bool flag_I_;
-  // bool flag_B_;
-  bool flag_D_;
-  bool flag_V_;
-  bool flag_N_;
-#endif  // PSW_IN_BYTE
-
-  Byte irq_flag_;
-
   MainBus& bus_;
 };
 
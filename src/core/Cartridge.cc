@@ -4,7 +4,6 @@
 #include <string>
 
 #include "glog/logging.h"
-#include "utils.h"
 
 //
 //
@@ -30,7 +29,11 @@
 //
 namespace hn {
 Cartridge::Cartridge()
-    : nameTableMirroring_(0), mapperNumber_(0), extendedRAM_(false) {}
+    : nameTableMirroring_(0),
+      mapperNumber_(0),
+      extendedRAM_(false),
+      bus_(nullptr),
+      tag_("fcgame") {}
 const std::vector<Byte> &Cartridge::getROM() const { return PRG_ROM_; }
 
 const std::vector<Byte> &Cartridge::getVROM() const { return CHR_ROM_; }
@@ -142,15 +145,13 @@ bool Cartridge::loadFromFile(std::string path) {
 
   size_t pos = path.find_last_of("/\\");
   pos = (pos == std::string::npos) ? 0 : pos + 1;
-  std::string tag = path.substr(pos);
+  tag_ = path.substr(pos);
 
-  pos = tag.find_last_of(".");
+  pos = tag_.find_last_of(".");
   if (pos != std::string::npos) {
-    tag = tag.substr(0, pos);
+    tag_ = tag_.substr(0, pos);
   }
 
-  Helper::setTag(tag);
-
   return true;
 }
 
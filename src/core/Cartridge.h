@@ -92,6 +92,8 @@ class Cartridge {
   MainBus *bus() const;
 
   std::string nes_path() const { return nesPath_; }
+  // Names the files saved for this game, the ROM name without the extension
+  std::string tag() const { return tag_; }
   const CartridgeHeader &header() const { return header_; }
 
  private:
@@ -108,6 +110,7 @@ class Cartridge {
   MainBus *bus_;
 
   std::string nesPath_;
+  std::string tag_;
 };
 
 };  // namespace hn
@@ -1,7 +1,10 @@
 #include "Emulator.h"
 
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
 #include <fstream>
+#include <sstream>
 #include <thread>
 
 #include "glog/logging.h"
@@ -9,6 +12,25 @@
 
 namespace hn {
 constexpr uint32_t kSaveDocMark = 0x1a444e48;
+// 2: joypad inputs recorded per frame
+// 3: keyframes of the recording after the state
+// 4: RAM and picture hashes in the recording
+// 5: state hashes, XXH64, instead of the RAM
+// 6: mapper registers hashed as their plain state
+// 7: keyframes as deltas against the one before
+constexpr uint32_t kSaveDocVersion = 7;
+// CPU cycles run at once by RunFrame, about one scanline
+constexpr std::size_t kFrameSliceCycles = 114;
+// A state is kept for rewinding every frame, in an arena that holds a few
+// minutes of them
+constexpr std::size_t kRewindArenaSize = 4 << 20;
+// A keyframe is kept for seeking in replays every that many frames, about ten
+// seconds
+constexpr std::size_t kKeyframeInterval = 600;
+// Replays are checked against the recording every that many frames
+constexpr std::size_t kCheckInterval = 60;
+// Frames run ahead at most, all of them are run again every frame
+constexpr int kMaxRunAhead = 3;
 
 Emulator::Emulator()
     : cpu_(bus_),
@@ -16,25 +38,40 @@ Emulator::Emulator()
       apu_(bus_),
       goldfinger_(bus_),
       screenScale_(2.f),
-      cycleTimer_(),
       workMode_(RECORDING),
-      cpuCycleDuration_(std::chrono::nanoseconds(560)) {}
+      scheduler_(CYCLE_STEP),
+      rewind_(kRewindArenaSize),
+      runAhead_(0),
+      runningAhead_(false),
+      redrawing_(false),
+      stateHash_(0),
+      hashLog_(nullptr),
+      checkedFrames_(0),
+      mismatchedFrames_(0) {
+  // The checks hash the picture, which must be there whatever the frame skip
+  ppu_.SetDrawInterval(kCheckInterval);
+}
 
 void Emulator::Reset() {
   frameIdx_ = 0;
+  stateHash_ = 0;
+  cycle_ = ppuCycle_ = apuCycle_ = ppuDeadline_ = apuDeadline_ = 0;
+  joypad_ = JoypadState();
+  joypad_.frame = static_cast<std::size_t>(-1);
 
   mapper_->Reset();
   cpu_.Reset();
   ppu_.Reset();
   apu_.Reset();
   bus_.Reset();
-  cycleTimer_ = std::chrono::high_resolution_clock::now();
-  elapsedTime_ = cycleTimer_ - cycleTimer_;
+  rewind_.Clear();
+  pacer_.Restart();
 }
 
 bool Emulator::HardwareSetup() {
   ppu_.SetScreen(emulatorScreen_.get());
   apu_.SetSpeaker(emulatorSpeaker_.get());
+  pacer_.setSpeaker(emulatorSpeaker_.get());
 
   if (!bus_.setReadCallback(PPUSTATUS,
                             [&](void) { return ppu_.getStatus(); }) ||
@@ -54,16 +91,17 @@ bool Emulator::HardwareSetup() {
       !bus_.setWriteCallback(PPUSCROL, [&](Byte b) { ppu_.setScroll(b); }) ||
       !bus_.setWriteCallback(PPUDATA, [&](Byte b) { ppu_.setData(b); }) ||
       !bus_.setWriteCallback(OAMDMA, [&](Byte b) { DMA(b); }) ||
-      !bus_.setWriteCallback(JOY1,
-                             [&](Byte b) {
-                               emulatorJoypads_[0]->strobe(b);
-                               emulatorJoypads_[1]->strobe(b);
-                             }) ||
+      !bus_.setWriteCallback(JOY1, [&](Byte b) { StrobeJoypads(b); }) ||
       !bus_.setWriteCallback(OAMDATA, [&](Byte b) { ppu_.setOAMData(b); })) {
     LOG(ERROR) << "Critical error: Failed to set I/O callbacks";
     return false;
   }
 
+  bus_.setSyncCallback([&](void) {
+    CatchUp(cycle_, cycle_ ? cycle_ - 1 : 0);
+    ppu_.SyncRender();
+  });
+
   record_.setFinishCallback([&]() {
     OnPause();
     workMode_ = RECORDING;
@@ -88,32 +126,195 @@ bool Emulator::HardwareSetup() {
   return true;
 }
 
+void Emulator::setSpeed(int factor) { pacer_.setSpeed(factor); }
+
+void Emulator::setRunAhead(int frames) {
+  runAhead_ = std::max(0, std::min(frames, kMaxRunAhead));
+}
+
 void Emulator::RunTick(bool running) {
-  if (running) {
-    elapsedTime_ += std::chrono::high_resolution_clock::now() - cycleTimer_;
-    cycleTimer_ = std::chrono::high_resolution_clock::now();
+  if (!running) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000 / 60));
+    pacer_.Restart();
+    return;
+  }
 
-    while (elapsedTime_ > cpuCycleDuration_) {
-      XPUTick();
+  // A whole frame per wakeup, when the pacer says it is due
+  pacer_.Wait();
+  apu_.SetRateRatio(pacer_.rateRatio());
+  if (runAhead_ > 0 && workMode_ != REPLAY) {
+    RunFrameAhead();
+  } else {
+    RunFrame();
+  }
+  KeepRewindState();
+}
 
-      elapsedTime_ -= cpuCycleDuration_;
-    }
+void Emulator::KeepRewindState() {
+  state_.Clear();
+  SnapshotTo(state_);
+  rewind_.Push(state_);
+}
+
+void Emulator::RunFrame() {
+  RunToNextFrame();
+  FrameRefresh();
+}
+
+void Emulator::RunFrameAhead() {
+  // The frame itself is heard, but not seen
+  ppu_.SetScreen(nullptr);
+  ppu_.SetPictureHidden(runAhead_ > 1);
+  RunToNextFrame();
+
+  aheadState_.Clear();
+  SnapshotTo(aheadState_);
+
+  // The frames ahead are not heard and leave nothing in the recording. Only
+  // the last one is seen, and only the ones seen are drawn: the frame after
+  // it is the next one run for real
+  runningAhead_ = true;
+  apu_.SetRunAhead(true);
+  for (int ahead = 1; ahead <= runAhead_; ++ahead) {
+    if (ahead == runAhead_) ppu_.SetScreen(emulatorScreen_.get());
+    ppu_.SetPictureHidden(ahead + 1 < runAhead_);
+    RunToNextFrame();
+  }
+  FrameRefresh();
+
+  aheadState_.Seek(0);
+  RestoreFrom(aheadState_);
+  apu_.SetRunAhead(false);
+  runningAhead_ = false;
+}
+
+void Emulator::RunToNextFrame() {
+  while (!RunSlice()) {
+  }
+}
+
+bool Emulator::RunSlice() {
+  RunCycles(kFrameSliceCycles);
+  if (frameIdx_ == ppu_.frameIndex()) return false;
+
+  // The first slice end of a frame is its checkpoint
+  frameIdx_ = ppu_.frameIndex();
+  if (runningAhead_) return true;
+
+  HashState();
+  KeepKeyframe();
+  VerifyFrame();
+  if (workMode_ == RECORDING && frameIdx_ % kCheckInterval == 0) {
+    record_.Flush();
+  }
+  return true;
+}
+
+void Emulator::KeepKeyframe() {
+  if (workMode_ != RECORDING || frameIdx_ % kKeyframeInterval != 0) return;
+
+  state_.Clear();
+  SnapshotTo(state_);
+  record_.AddKeyframe(frameIdx_, state_);
+}
+
+void Emulator::HashState() {
+  StateHash hash;
+  cpu_.Hash(hash);
+  bus_.Hash(hash);
+  pictureBus_.Hash(hash);
+  ppu_.Hash(hash);
+
+  mapperState_.Clear();
+  mapper_->SnapshotTo(mapperState_);
+  hash.Update(mapperState_.data(), mapperState_.size());
+
+  stateHash_ = hash.Digest();
+  if (hashLog_) {
+    char line[64];
+    snprintf(line, sizeof(line), "%zu %016llx\n", frameIdx_,
+             static_cast<unsigned long long>(stateHash_));
+    *hashLog_ << line;
+  }
+}
 
-    if (frameIdx_ < ppu_.frameIndex()) {
-      FrameRefresh();
-      frameIdx_ = ppu_.frameIndex();
+void Emulator::VerifyFrame() {
+  if (frameIdx_ % kCheckInterval != 0) return;
+
+  if (workMode_ == RECORDING) {
+    record_.AddCheck(frameIdx_, FrameHash());
+  } else if (workMode_ == REPLAY) {
+    uint64_t hash;
+    if (!record_.FindCheck(frameIdx_, hash)) return;
+
+    ++checkedFrames_;
+    if (hash != FrameHash()) {
+      if (mismatchedFrames_++ == 0) {
+        LOG(ERROR) << "Replay diverges at frame " << frameIdx_;
+      }
     }
+  }
+}
+
+uint64_t Emulator::FrameHash() {
+  ppu_.SyncRender();
+
+  StateHash hash;
+  hash.Add(stateHash_);
+  hash.Update(ppu_.picture());
+  return hash.Digest();
+}
+
+bool Emulator::Seek(std::size_t frame) {
+  if (workMode_ != REPLAY) return false;
+
+  // From the frame before, so that the picture of the frame is drawn
+  std::size_t key = record_.FindKeyframe(frame, state_);
+  if (key == static_cast<std::size_t>(-1)) {
+    Reset();
   } else {
-    std::this_thread::sleep_for(std::chrono::milliseconds(1000 / 60));
+    state_.Seek(0);
+    RestoreFrom(state_);
   }
+  rewind_.Clear();
+
+  while (ppu_.frameIndex() < frame && workMode_ == REPLAY) {
+    RunToNextFrame();
+  }
+  FrameRefresh();
+  return ppu_.frameIndex() >= frame;
+}
+
+void Emulator::RunCycles(std::size_t cycles) {
+  if (scheduler_ == CYCLE_STEP || mapper_->clockedByCPU()) {
+    while (cycles--) {
+      XPUTick();
+    }
+    return;
+  }
+
+  std::size_t target = cycle_ + cycles;
+  DDTRY();
+  while (cycle_ + cpu_.idle_cycles() < target) {
+    InstructionTick();
+  }
+
+  // Leave every device at the end of the slice, so the frame index is up to
+  // date and the scheduler may be switched
+  cpu_.Idle(target - cycle_);
+  cycle_ = target;
+  CatchUp(target, target);
+  DDCATCH();
 }
 
 void Emulator::XPUTick() {
   DDTRY();
+  ++cycle_;
   // PPU
   ppu_.Step();
   ppu_.Step();
   ppu_.Step();
+  ppuCycle_ = cycle_;
   // CPU
   cpu_.Step();
   // APU
@@ -121,9 +322,37 @@ void Emulator::XPUTick() {
 
   // clock tick
   bus_.Tick();
+  apuCycle_ = cycle_;
   DDCATCH();
+}
 
-  goldfinger_.Patrol();
+void Emulator::InstructionTick() {
+  std::size_t cycle = cycle_ + cpu_.idle_cycles() + 1;
+
+  // Within a cycle the PPU steps before the CPU, the APU and mapper after it.
+  // Interrupts are only sampled here, so the devices need to catch up only if
+  // they could have raised one.
+  if (cycle >= ppuDeadline_ || cycle > apuDeadline_) {
+    CatchUp(cycle, cycle - 1);
+  }
+
+  cycle_ = cycle;
+  cpu_.StepInstruction();
+}
+
+void Emulator::CatchUp(std::size_t ppu_cycle, std::size_t apu_cycle) {
+  if (ppuCycle_ < ppu_cycle) {
+    ppu_.Run(3 * (ppu_cycle - ppuCycle_));
+    ppuCycle_ = ppu_cycle;
+  }
+
+  if (apuCycle_ < apu_cycle) {
+    apu_.Run(apu_cycle - apuCycle_);
+    apuCycle_ = apu_cycle;
+  }
+
+  ppuDeadline_ = ppuCycle_ + (ppu_.DotsToEvent() + 2) / 3;
+  apuDeadline_ = apuCycle_ + apu_.CyclesToEvent();
 }
 
 void Emulator::DMA(Byte page) {
@@ -131,21 +360,44 @@ void Emulator::DMA(Byte page) {
   ppu_.doDMA(bus_.getPagePtr(page));
 }
 
+void Emulator::PollJoypads() {
+  std::size_t frame = ppu_.frameIndex();
+  if (joypad_.frame == frame) return;
+  joypad_.frame = frame;
+
+  if (workMode_ == REPLAY || redrawing_) {
+    record_.Read(frame, joypad_.buttons);
+    return;
+  }
+
+  for (int no = 0; no < OperatingRecord::kPlayers; ++no) {
+    joypad_.buttons[no] = emulatorJoypads_[no]->buttons();
+  }
+  if (workMode_ == RECORDING && !runningAhead_) {
+    record_.Record(frame, joypad_.buttons);
+  }
+}
+
+void Emulator::StrobeJoypads(Byte b) {
+  PollJoypads();
+
+  joypad_.strobe = b & 1;
+  if (!joypad_.strobe) {
+    std::copy_n(joypad_.buttons, OperatingRecord::kPlayers, joypad_.shift);
+  }
+}
+
 Byte Emulator::ReadJoypad(int no) {
+  PollJoypads();
+
   Byte ret;
-  if (workMode_ == REPLAY) {
-    return record_.Read(no, cpu_.clock_cycles());
+  if (joypad_.strobe) {
+    ret = joypad_.buttons[no] & 1;
   } else {
-    ret = emulatorJoypads_[no]->read();
-
-    if (workMode_ == RECORDING) {
-      if (ret & 0xbf) {
-        record_.Record(no, cpu_.clock_cycles(), ret);
-      }
-    }
+    ret = joypad_.shift[no] & 1;
+    joypad_.shift[no] >>= 1;
   }
-
-  return ret;
+  return ret | 0x40;
 }
 
 void Emulator::ToggleWorkMode() {
@@ -157,7 +409,7 @@ void Emulator::ToggleWorkMode() {
     case RECORDING:
       workMode_ = REPLAY;
       HintText("Start replay");
-      record_.Save();
+      record_.Flush();
       Reset();
       break;
     default:
@@ -236,6 +488,12 @@ void Emulator::RestoreRecord() {
     return;
   }
 
+  // Record files only have the inputs, played from power on
+  if (record_.Load(record_file_)) {
+    checkedFrames_ = mismatchedFrames_ = 0;
+    return;
+  }
+
   std::ifstream is(record_file_);
   if (is.good()) {
     Restore(is);
@@ -243,7 +501,7 @@ void Emulator::RestoreRecord() {
 }
 
 void Emulator::SaveRecord() {
-  record_file_ = Helper::NewFileName(record_file_);
+  record_file_ = Helper::NewFileName(cartridge_.tag());
 
   std::ofstream file(record_file_);
   Save(file);
@@ -262,15 +520,20 @@ void Emulator::DebugDump() {
 
 void Emulator::Save(std::ostream &os) {
   WriteNum(os, kSaveDocMark);
-  WriteNum(os, 1);
-  Write(os, Helper::tag());
+  WriteNum(os, kSaveDocVersion);
+  Write(os, cartridge_.tag());
 
   // Operations recording
-  record_.setTopCycle(cpu_.clock_cycles());
   record_.Save(os);
 
+  SaveState(os);
+  record_.SaveKeyframes(os);
+}
+
+void Emulator::SaveState(std::ostream &os) {
   // Member variable
   Write(os, frameIdx_);
+  Write(os, joypad_);
 
   // Components
   bus_.Save(os);
@@ -290,23 +553,38 @@ void Emulator::Restore(std::istream &is) {
   }
 
   version = ReadNum(is);
-  if (version != 1) {
+  if (version != kSaveDocVersion) {
     LOG(ERROR) << "Unsupport recording file version";
     return;
   }
 
   std::string tag;
   Read(is, tag);
-  if (tag != Helper::tag()) {
-    LOG(ERROR) << "[CAUTION] tag: " << tag << " != " << Helper::tag();
+  if (tag != cartridge_.tag()) {
+    LOG(ERROR) << "[CAUTION] tag: " << tag << " != " << cartridge_.tag();
   }
 
   // Operations recording
   record_.Restore(is);
-  if (workMode_ == REPLAY) return;
+  checkedFrames_ = mismatchedFrames_ = 0;
+  if (workMode_ == REPLAY) {
+    record_.RestoreKeyframes(is);
+    return;
+  }
+
+  RestoreState(is);
+  record_.RestoreKeyframes(is);
+  rewind_.Clear();
+
+  // Pause for giving player a reaction tolerance
+  pausing_ = true;
+  FrameRefresh();
+}
 
+void Emulator::RestoreState(std::istream &is) {
   // Member variable
   Read(is, frameIdx_);
+  Read(is, joypad_);
 
   // Components
   bus_.Restore(is);
@@ -317,9 +595,61 @@ void Emulator::Restore(std::istream &is) {
   // Cartridge cartridge_;
   mapper_->Restore(is);
 
-  // Pause for giving player a reaction tolerance
-  pausing_ = true;
-  FrameRefresh();
+  cycle_ = ppuCycle_ = apuCycle_ = ppuDeadline_ = apuDeadline_ = 0;
+}
+
+void Emulator::SnapshotTo(StateBuffer &buffer) {
+  buffer.Put(frameIdx_);
+  buffer.Put(joypad_);
+
+  bus_.SnapshotTo(buffer);
+  pictureBus_.SnapshotTo(buffer);
+  cpu_.SnapshotTo(buffer);
+  ppu_.SnapshotTo(buffer);
+  apu_.SnapshotTo(buffer);
+  mapper_->SnapshotTo(buffer);
+}
+
+void Emulator::RestoreFrom(StateBuffer &buffer) {
+  buffer.Get(frameIdx_);
+  buffer.Get(joypad_);
+
+  bus_.RestoreFrom(buffer);
+  pictureBus_.RestoreFrom(buffer);
+  cpu_.RestoreFrom(buffer);
+  ppu_.RestoreFrom(buffer);
+  apu_.RestoreFrom(buffer);
+  mapper_->RestoreFrom(buffer);
+
+  cycle_ = ppuCycle_ = apuCycle_ = ppuDeadline_ = apuDeadline_ = 0;
+}
+
+bool Emulator::Rewind() {
+  // The newest state is the one the frame on screen ended at, the one before
+  // it drew that frame. The frame before is drawn from the third one, which
+  // is kept along with the state it ends at for the next step back
+  if (rewind_.size() < 3) return false;
+  rewind_.Pop(state_);
+  rewind_.Pop(state_);
+  rewind_.Pop(state_);
+  rewind_.Push(state_);
+
+  state_.Seek(0);
+  RestoreFrom(state_);
+
+  // Run again with the buttons played then, not the ones held now
+  redrawing_ = true;
+  RunFrame();
+  redrawing_ = false;
+  KeepRewindState();
+
+  if (workMode_ == RECORDING) {
+    // The redraw ended at the checkpoint of the frame and took its keyframe
+    // and check again, the frames after it are played anew. Buttons still
+    // to be taken in it are recorded over the old ones
+    record_.Truncate(frameIdx_ + 1);
+  }
+  return true;
 }
 
 }  // namespace hn
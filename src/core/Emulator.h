@@ -5,12 +5,14 @@
 
 #include "APU.h"
 #include "CPU.h"
+#include "FramePacer.h"
 #include "GoldFinger.h"
 #include "MainBus.h"
 #include "OpRecord.h"
 #include "PPU.h"
 #include "PeripheralDevices.h"
 #include "PictureBus.h"
+#include "RewindBuffer.h"
 #include "common.h"
 
 namespace hn {
@@ -33,6 +35,25 @@ class Emulator : public Serialize {
 
   enum { PLAYING, RECORDING, RECORDED, REPLAY } workMode_;
 
+  // CYCLE_STEP clocks every device on every CPU cycle. CATCH_UP runs the CPU
+  // an instruction at a time and brings the PPU, APU and mapper up to its
+  // cycle only when they could be observed.
+  enum SchedulerMode { CYCLE_STEP, CATCH_UP };
+  void setScheduler(SchedulerMode mode) { scheduler_ = mode; }
+
+  // Without audio the APU skips making samples, the game runs the same
+  void setAudioEnabled(bool enabled) { apu_.SetAudioEnabled(enabled); }
+  // Draws only `period - skip` frames out of every period, see PPU
+  void setFrameSkip(int skip, int period) { ppu_.SetFrameSkip(skip, period); }
+  // Runs factor times as fast as the NES
+  void setSpeed(int factor);
+  // What RunTick follows to run the frames, see FramePacer
+  void setPacing(FramePacer::Mode mode) { pacer_.setMode(mode); }
+  // Shows the frame that many frames ahead, run with the buttons held now
+  // and then taken back, which hides the input lag of the game. Up to 3, not
+  // while replaying
+  void setRunAhead(int frames);
+
   bool LoadCartridge(const std::string &rom_path);
   void setCartridge(const Cartridge &cartridge);
 
@@ -41,18 +62,48 @@ class Emulator : public Serialize {
   void Pause();
   void Resume();
   void Reset();
+  // Goes to the start of the frame of the replay, from the keyframe before
+  // it. False if not replaying or the replay ends before
+  bool Seek(std::size_t frame);
+
+  std::size_t frameIndex() const { return frameIdx_; }
+  // Hash of the CPU registers, the memories and the mapper at the end of the
+  // last frame. Same machine state, same hash, whichever scheduler ran it
+  uint64_t stateHash() const { return stateHash_; }
+  // Writes "frame hash" lines for every frame, nullptr to stop
+  void setHashLog(std::ostream *log) { hashLog_ = log; }
+  // Frames of the replay checked against the hashes of the recording, and
+  // how many of them differ
+  std::size_t checkedFrames() const { return checkedFrames_; }
+  std::size_t mismatchedFrames() const { return mismatchedFrames_; }
   void HintText(const std::string &text);
 
   virtual void Save(std::ostream &os) override;
   virtual void Restore(std::istream &is) override;
+  // Machine state only, no header, recording or picture: for the states
+  // taken while running
+  virtual void SnapshotTo(StateBuffer &buffer) override;
+  virtual void RestoreFrom(StateBuffer &buffer) override;
 
  protected:
   void DebugDump();
 
   bool HardwareSetup();
+  // Waits for the next frame and runs it, or idles when not running
   void RunTick(bool running);
+  void RunCycles(std::size_t cycles);
+  // Runs until the PPU moves on to the next frame, ignoring wall-clock time
+  void RunFrame();
+  // Runs the frame, then shows the one run ahead from it
+  void RunFrameAhead();
+  void RunToNextFrame();
   void RestoreRecord();
   void SaveRecord();
+  // Goes back one frame and draws it again with the buttons recorded for it,
+  // false if there are no states kept that far back. The states are taken
+  // some way into a frame, each one after the frame before it was drawn
+  bool Rewind();
+  void KeepRewindState();
 
   void LostFocus();
   void GetFocus();
@@ -67,7 +118,7 @@ class Emulator : public Serialize {
   std::unique_ptr<VirtualJoypad> emulatorJoypads_[2];
 
   float screenScale_;
-  TimePoint cycleTimer_;
+  FramePacer pacer_;
 
   GoldFinger goldfinger_;
   Cartridge cartridge_;
@@ -79,7 +130,24 @@ class Emulator : public Serialize {
  private:
   void DMA(Byte page);
   void XPUTick();
+  void InstructionTick();
+  void CatchUp(std::size_t ppu_cycle, std::size_t apu_cycle);
+  // Runs a slice of the frame, true if a frame ended in it
+  bool RunSlice();
+  // Snapshots the machine for the recording now and then
+  void KeepKeyframe();
+  void HashState();
+  // Hashes the frame for the recording, or checks the replay against it
+  void VerifyFrame();
+  // The state hash and the picture
+  uint64_t FrameHash();
+  // Takes the buttons of the frame, the first time a joypad is used in it
+  void PollJoypads();
+  void StrobeJoypads(Byte b);
   Byte ReadJoypad(int no);
+  // Everything but the header and the operations recording
+  void SaveState(std::ostream &os);
+  void RestoreState(std::istream &is);
 
   MainBus bus_;
   PictureBus pictureBus_;
@@ -88,9 +156,39 @@ class Emulator : public Serialize {
   APU apu_;
 
   size_t frameIdx_;
+
+  // Shift registers of the NES controllers, latching the buttons of the frame
+  struct JoypadState {
+    std::size_t frame;  // the buttons were taken in
+    Byte buttons[OperatingRecord::kPlayers];
+    Byte shift[OperatingRecord::kPlayers];
+    bool strobe;
+  } joypad_;
+
+  SchedulerMode scheduler_;
+  // CPU cycles since reset, and how far the PPU and APU have been run
+  std::size_t cycle_;
+  std::size_t ppuCycle_;
+  std::size_t apuCycle_;
+  // First cycles at which the PPU or APU may raise an interrupt
+  std::size_t ppuDeadline_;
+  std::size_t apuDeadline_;
   std::string record_file_;
-  std::chrono::high_resolution_clock::duration elapsedTime_;
-  std::chrono::nanoseconds cpuCycleDuration_;
+
+  RewindBuffer rewind_;
+  StateBuffer state_;
+
+  int runAhead_;
+  bool runningAhead_;  // in frames to be taken back
+  StateBuffer aheadState_;
+  bool redrawing_;  // a rewound frame, with the buttons of the recording
+
+  uint64_t stateHash_;
+  std::ostream *hashLog_;
+  StateBuffer mapperState_;  // mappers are hashed through their snapshots
+
+  std::size_t checkedFrames_;
+  std::size_t mismatchedFrames_;
 };
 
 }  // namespace hn
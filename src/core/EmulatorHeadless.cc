@@ -0,0 +1,78 @@
+#include "EmulatorHeadless.h"
+
+#include <chrono>
+
+#include "devices/NullDevices.h"
+#include "devices/RecordScreen.h"
+#include "devices/RecordSpeaker.h"
+#include "glog/logging.h"
+#include "utils.h"
+
+namespace hn {
+EmulatorHeadless::EmulatorHeadless(bool capture, unsigned int sample_rate)
+    : Emulator(),
+      frameCount_(0),
+      seekFrame_(0),
+      framesRun_(0),
+      seconds_(0),
+      replayFinished_(false),
+      capture_(capture),
+      sampleRate_(sample_rate) {
+  if (!capture_) {
+    emulatorScreen_.reset(new NullScreen);
+    emulatorSpeaker_.reset(new NullSpeaker);
+    setAudioEnabled(false);
+  }
+
+  emulatorJoypads_[0].reset(new NullJoypad);
+  emulatorJoypads_[1].reset(new NullJoypad);
+}
+
+void EmulatorHeadless::run() {
+  // The captures are named after the cartridge, only set by now
+  if (capture_) {
+    emulatorScreen_.reset(
+        new RecordScreen(Helper::SequenceImageName(cartridge_.tag())));
+    emulatorSpeaker_.reset(new RecordSpeaker(
+        Helper::GenSoundRecordName(cartridge_.tag()), 1, sampleRate_));
+  }
+
+  if (!HardwareSetup()) {
+    return;
+  }
+
+  if (frameCount_ == 0 && workMode_ != REPLAY) {
+    LOG(ERROR) << "A frame count is required when not replaying";
+    return;
+  }
+
+  emulatorScreen_->create(NESVideoWidth, NESVideoHeight, 1, 0x30);
+
+  Reset();
+  RestoreRecord();
+  pausing_ = false;
+  replayFinished_ = false;
+
+  if (seekFrame_ > 0 && !Seek(seekFrame_)) {
+    LOG(ERROR) << "Failed to seek to frame " << seekFrame_;
+    return;
+  }
+
+  auto start = std::chrono::high_resolution_clock::now();
+  framesRun_ = 0;
+  while (!replayFinished_ && (frameCount_ == 0 || framesRun_ < frameCount_)) {
+    RunFrame();
+    ++framesRun_;
+
+    // Some games stop reading the joypads, the replay ends with the recording
+    if (workMode_ == REPLAY && frameIndex() >= record_.length()) break;
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::high_resolution_clock::now() - start;
+  seconds_ = elapsed.count();
+}
+
+// Called once the replay finishes
+void EmulatorHeadless::OnPause() { replayFinished_ = true; }
+
+}  // namespace hn
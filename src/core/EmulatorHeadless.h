@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Emulator.h"
+
+namespace hn {
+
+// Runs without a window, as fast as possible, for a number of frames or
+// until the replay finishes
+class EmulatorHeadless : public Emulator {
+ public:
+  // With capture, the last frame and the sound are recorded to files
+  EmulatorHeadless(bool capture = false, unsigned int sample_rate = 44100);
+
+  virtual void run() override;
+  virtual void FrameRefresh() override {}
+
+  // 0 runs until the replay finishes
+  void setFrameCount(std::size_t frames) { frameCount_ = frames; }
+  // The replay starts at this frame
+  void setSeekFrame(std::size_t frame) { seekFrame_ = frame; }
+
+  // Of the last run
+  std::size_t framesRun() const { return framesRun_; }
+  double seconds() const { return seconds_; }
+
+ protected:
+  virtual void OnPause() override;
+
+ private:
+  std::size_t frameCount_;
+  std::size_t seekFrame_;
+  std::size_t framesRun_;
+  double seconds_;
+  bool replayFinished_;
+  bool capture_;
+  unsigned int sampleRate_;
+};
+
+}  // namespace hn
@@ -8,32 +8,49 @@
 #include "devices/SfmlJoypad.h"
 #include "devices/SfmlScreen.h"
 #include "devices/SfmlSpeaker.h"
+#include "glog/logging.h"
 #include "utils.h"
 
 namespace hn {
-EmulatorSfml::EmulatorSfml() : Emulator(), sfScreen_(new VirtualScreenSfml) {
-  if (record_mode_) {
-    emulatorScreen_.reset(new RecordScreen(Helper::SequenceImageName()));
-    dynamic_cast<RecordScreen*>(emulatorScreen_.get())->SetOutScreen(sfScreen_);
+// Fast forward speed, only one frame out of that many is drawn
+constexpr int kFastForwardSpeed = 4;
+// Commands not taken yet by the emulation, the later ones are dropped
+constexpr std::size_t kCommandQueueSize = 32;
 
-    emulatorSpeaker_.reset(new RecordSpeaker(Helper::GenSoundRecordName()));
-    dynamic_cast<RecordSpeaker*>(emulatorSpeaker_.get())
-        ->SetOutSpeaker(new VirtualSpeakerSfml);
-  } else {
-    emulatorScreen_.reset(sfScreen_);
-    emulatorSpeaker_.reset(new VirtualSpeakerSfml);
-  }
+EmulatorSfml::EmulatorSfml(unsigned int sample_rate)
+    : Emulator(),
+      sfScreen_(new VirtualScreenSfml),
+      sfJoypads_{new VirtualJoypadSfml, new VirtualJoypadSfml},
+      running_(false),
+      rewinding_(false),
+      commands_(kCommandQueueSize) {
+  emulatorScreen_.reset(sfScreen_);
+  emulatorSpeaker_.reset(new VirtualSpeakerSfml(1, sample_rate));
 
-  emulatorJoypads_[0].reset(new VirtualJoypadSfml);
-  emulatorJoypads_[1].reset(new VirtualJoypadSfml);
+  emulatorJoypads_[0].reset(sfJoypads_[0]);
+  emulatorJoypads_[1].reset(sfJoypads_[1]);
 }
 
 void EmulatorSfml::FrameRefresh() {
-  window_.draw(*sfScreen_);
-  window_.display();
+  // The frames go to the window through the screen, the window thread draws
+  // the last one whenever it is ready
 }
 
 void EmulatorSfml::run() {
+  // The records are named after the cartridge, only set by now
+  if (record_mode_) {
+    RecordScreen* screen =
+        new RecordScreen(Helper::SequenceImageName(cartridge_.tag()));
+    screen->SetOutScreen(emulatorScreen_.release());
+    emulatorScreen_.reset(screen);
+
+    RecordSpeaker* speaker =
+        new RecordSpeaker(Helper::GenSoundRecordName(cartridge_.tag()), 1,
+                          emulatorSpeaker_->sampleRate());
+    speaker->SetOutSpeaker(emulatorSpeaker_.release());
+    emulatorSpeaker_.reset(speaker);
+  }
+
   if (!HardwareSetup()) {
     return;
   }
@@ -48,6 +65,11 @@ void EmulatorSfml::run() {
 
   Reset();
   RestoreRecord();
+  if (workMode_ == RECORDING) {
+    record_.Open(Helper::GenInputRecordName(cartridge_.tag()));
+  }
+
+  StartEmulation();
 
   sf::Event event;
   bool focus = true;
@@ -56,38 +78,40 @@ void EmulatorSfml::run() {
       if (event.type == sf::Event::Closed ||
           (event.type == sf::Event::KeyPressed &&
            event.key.code == sf::Keyboard::Escape)) {
+        StopEmulation();
         window_.close();
         return;
       } else if (event.type == sf::Event::GainedFocus) {
         focus = true;
-        cycleTimer_ = std::chrono::high_resolution_clock::now();
-        GetFocus();
+        Post(GAINED_FOCUS);
       } else if (event.type == sf::Event::LostFocus) {
         focus = false;
-        LostFocus();
+        Post(LOST_FOCUS);
       } else if (event.type == sf::Event::KeyPressed &&
                  event.key.code == sf::Keyboard::F1) {
-        Reset();
-        HintText("Game reset");
+        Post(RESET);
       } else if (focus && event.type == sf::Event::KeyReleased) {
         switch (event.key.code) {
           case sf::Keyboard::F2:
-            OnPauseToggle();
+            Post(PAUSE_TOGGLE);
             break;
           case sf::Keyboard::F3:
-            OnDebug();
+            Post(DEBUG_DUMP);
             break;
           case sf::Keyboard::F4:
-            OnSaveRecord();
+            Post(SAVE_RECORD);
             break;
           case sf::Keyboard::F5:
-            ToggleWorkMode();
+            Post(WORK_MODE_TOGGLE);
             break;
           case sf::Keyboard::F6:
             OnPatternView();
             break;
           case sf::Keyboard::F7:
-            OnGoldFingerToggle();
+            Post(GOLD_FINGER_TOGGLE);
+            break;
+          case sf::Keyboard::F8:
+            Post(FAST_FORWARD_TOGGLE);
             break;
           case sf::Keyboard::F12:
             CaptureImage();
@@ -101,20 +125,100 @@ void EmulatorSfml::run() {
     if (true /**/ && focus) {
       static bool jpAction = true;
       if (sf::Joystick::isButtonPressed(0, 6)) {
-        if (jpAction) OnGoldFingerToggle();
+        if (jpAction) Post(GOLD_FINGER_TOGGLE);
         jpAction = false;
       } else if (sf::Joystick::isButtonPressed(0, 4)) {
-        if (jpAction) OnSaveRecord();
+        if (jpAction) Post(SAVE_RECORD);
         jpAction = false;
       } else if (sf::Joystick::isButtonPressed(0, 5)) {
-        if (jpAction) OnPauseToggle();
+        if (jpAction) Post(PAUSE_TOGGLE);
         jpAction = false;
       } else {
         jpAction = true;
       }
     }
 
-    RunTick(focus && !pausing_);
+    sfJoypads_[0]->Sample();
+    sfJoypads_[1]->Sample();
+    // Rewinds for as long as the key is held
+    rewinding_ = focus && sf::Keyboard::isKeyPressed(sf::Keyboard::BackSpace);
+
+    window_.clear();
+    window_.draw(*sfScreen_);
+    window_.display();
+    pacer_.Vsync();
+  }
+
+  StopEmulation();
+}
+
+void EmulatorSfml::Post(Command command) {
+  if (!commands_.Push(&command, 1)) {
+    LOG(WARNING) << "Command queue full, command " << command << " dropped";
+  }
+}
+
+void EmulatorSfml::Execute(Command command) {
+  switch (command) {
+    case RESET:
+      Reset();
+      HintText("Game reset");
+      break;
+    case PAUSE_TOGGLE:
+      OnPauseToggle();
+      break;
+    case DEBUG_DUMP:
+      OnDebug();
+      break;
+    case SAVE_RECORD:
+      OnSaveRecord();
+      break;
+    case WORK_MODE_TOGGLE:
+      ToggleWorkMode();
+      break;
+    case GOLD_FINGER_TOGGLE:
+      OnGoldFingerToggle();
+      break;
+    case FAST_FORWARD_TOGGLE:
+      OnFastForwardToggle();
+      break;
+    case GAINED_FOCUS:
+      focus_ = true;
+      pacer_.Restart();
+      GetFocus();
+      break;
+    case LOST_FOCUS:
+      focus_ = false;
+      LostFocus();
+      break;
+  }
+}
+
+void EmulatorSfml::StartEmulation() {
+  running_ = true;
+  pacer_.Restart();
+  emulation_ = std::thread(&EmulatorSfml::RunEmulation, this);
+}
+
+void EmulatorSfml::StopEmulation() {
+  running_ = false;
+  if (emulation_.joinable()) emulation_.join();
+}
+
+void EmulatorSfml::RunEmulation() {
+  while (running_) {
+    Command command;
+    while (commands_.Pop(&command, 1)) {
+      Execute(command);
+    }
+
+    if (focus_ && rewinding_) {
+      // One frame back per frame the NES would have drawn
+      OnRewind();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1000 / 60));
+    } else {
+      RunTick(focus_ && !pausing_);
+    }
   }
 }
 
@@ -124,7 +228,7 @@ void EmulatorSfml::CaptureImage() {
   texture.update(window_);
 
   sf::Image image = texture.copyToImage();
-  image.saveToFile(Helper::GenImageCaptureName());
+  image.saveToFile(Helper::GenImageCaptureName(cartridge_.tag()));
 }
 
 void EmulatorSfml::OnGoldFingerToggle() {
@@ -138,6 +242,8 @@ void EmulatorSfml::OnSaveRecord() {
 }
 
 void EmulatorSfml::OnPatternView() {
+  // The viewer reads the mapper, the emulation stops until it is closed
+  StopEmulation();
   LostFocus();
 
   PatternViewer pv;
@@ -149,6 +255,7 @@ void EmulatorSfml::OnPatternView() {
   pv.run();
 
   GetFocus();
+  StartEmulation();
 }
 
 void EmulatorSfml::OnDebug() {
@@ -161,12 +268,26 @@ void EmulatorSfml::OnPauseToggle() {
   if (pausing_) {
     LostFocus();
     HintText("Game is pausing");
-    FrameRefresh();
   } else {
     GetFocus();
     HintText("Game resumes");
-    cycleTimer_ = std::chrono::high_resolution_clock::now();
+    pacer_.Restart();
+  }
+}
+
+void EmulatorSfml::OnFastForwardToggle() {
+  fast_forward_ = !fast_forward_;
+  setSpeed(fast_forward_ ? kFastForwardSpeed : 1);
+  setFrameSkip(fast_forward_ ? kFastForwardSpeed - 1 : 0, kFastForwardSpeed);
+  setAudioEnabled(!fast_forward_);
+  HintText(fast_forward_ ? "Fast forward" : "Normal speed");
+}
+
+void EmulatorSfml::OnRewind() {
+  if (!Rewind()) {
+    RunTick(false);
   }
+  pacer_.Restart();
 }
 
 void EmulatorSfml::OnPause() {
@@ -1,14 +1,20 @@
 #pragma once
 
 #include <SFML/Graphics.hpp>
+#include <atomic>
+#include <thread>
 
 #include "Emulator.h"
+#include "SpscRingBuffer.h"
 
 namespace hn {
 
+// The emulation runs on its own thread. The window thread draws the last
+// frame it finished, samples the joypads for it and sends it the commands,
+// so neither waits for the other.
 class EmulatorSfml : public Emulator {
  public:
-  EmulatorSfml();
+  EmulatorSfml(unsigned int sample_rate = 44100);
 
   virtual void run() override;
   virtual void FrameRefresh() override;
@@ -23,12 +29,41 @@ class EmulatorSfml : public Emulator {
   virtual void OnPause() override;
 
   void OnPauseToggle();
+  void OnFastForwardToggle();
+  void OnRewind();
 
  private:
+  // From the window thread to the emulation thread
+  enum Command {
+    RESET,
+    PAUSE_TOGGLE,
+    DEBUG_DUMP,
+    SAVE_RECORD,
+    WORK_MODE_TOGGLE,
+    GOLD_FINGER_TOGGLE,
+    FAST_FORWARD_TOGGLE,
+    GAINED_FOCUS,
+    LOST_FOCUS,
+  };
+  void Post(Command command);
+  void Execute(Command command);
+
+  void StartEmulation();
+  void StopEmulation();
+  void RunEmulation();
+
   bool record_mode_ = true;
+  bool fast_forward_ = false;
+  bool focus_ = true;  // emulation thread
   sf::RenderWindow window_;
 
   class VirtualScreenSfml* sfScreen_;
+  class VirtualJoypadSfml* sfJoypads_[2];
+
+  std::thread emulation_;
+  std::atomic<bool> running_;
+  std::atomic<bool> rewinding_;
+  SpscRingBuffer<Command> commands_;
 };
 
 }  // namespace hn
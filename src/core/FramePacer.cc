@@ -0,0 +1,124 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace hn {
+
+// NTSC frames are 29780.5 CPU cycles at 1789773Hz, 60.0988 frames a second
+constexpr std::chrono::duration<double> kNtscFrameDuration(29780.5 /
+                                                           1789773.0);
+// The speaker queue is kept about that many frames of samples long
+constexpr double kAudioLatencyFrames = 3;
+// The resampling rate is bent by no more than that, far below what is heard
+constexpr double kMaxRateDelta = 0.005;
+// Weight of a new queue size in its average
+constexpr double kQueueAverageWeight = 1.0 / 16;
+// Further behind the timer than that many frames, it starts over instead of
+// running the frames missed in a burst
+constexpr int kMaxLagFrames = 4;
+// Polling interval while waiting for the audio or the display
+constexpr std::chrono::milliseconds kPollInterval(1);
+// The display is followed only when it refreshes within that much of the NES
+// rate, measured over that long
+constexpr double kMaxRefreshDeviation = 0.01;
+constexpr std::chrono::seconds kRefreshWindow(1);
+
+FramePacer::FramePacer()
+    : mode_(TIMER),
+      speaker_(nullptr),
+      vsyncs_(0),
+      lastVsync_(0),
+      followVsync_(false) {
+  setSpeed(1);
+  Restart();
+}
+
+void FramePacer::setSpeed(int factor) {
+  speed_ = std::max(factor, 1);
+  period_ = std::chrono::duration_cast<Clock::duration>(kNtscFrameDuration /
+                                                        speed_);
+}
+
+void FramePacer::Restart() {
+  deadline_ = Clock::now();
+  queueAverage_ = -1;
+  rateRatio_ = 1;
+
+  refreshStart_ = deadline_;
+  refreshCount_ = vsyncs_.load(std::memory_order_acquire);
+}
+
+void FramePacer::Wait() {
+  auto now = Clock::now();
+  if (now - deadline_ > period_ * kMaxLagFrames) {
+    deadline_ = now;
+  }
+  MeasureRefresh(now);
+
+  // Never before the frame is due. Following the audio or the display, it
+  // waits for them up to a frame longer, as when the audio is stopped or the
+  // window is hidden. The deadline stays on the timer either way, so waiting
+  // now and then does not slow the frames down
+  std::this_thread::sleep_until(deadline_);
+  if (speed_ == 1 && mode_ == AUDIO && speaker_) {
+    WaitAudio(deadline_ + period_);
+  } else if (speed_ == 1 && mode_ == VSYNC && followVsync_) {
+    WaitVsync(deadline_ + period_);
+  }
+  deadline_ += period_;
+
+  UpdateRate();
+}
+
+void FramePacer::WaitAudio(Clock::time_point timeout) {
+  double target =
+      kAudioLatencyFrames * speaker_->sampleRate() * kNtscFrameDuration.count();
+  while (speaker_->queuedSamples() > target && Clock::now() < timeout) {
+    std::this_thread::sleep_for(kPollInterval);
+  }
+}
+
+void FramePacer::WaitVsync(Clock::time_point timeout) {
+  // The refresh that ran the frame before counts again if it came after this
+  // one was due, then two frames go on one refresh, as now and then on
+  // displays a little slower than the NES
+  auto since = deadline_.time_since_epoch().count();
+  while (lastVsync_.load(std::memory_order_acquire) < since &&
+         Clock::now() < timeout) {
+    std::this_thread::sleep_for(kPollInterval);
+  }
+}
+
+void FramePacer::MeasureRefresh(Clock::time_point now) {
+  if (now - refreshStart_ < kRefreshWindow) return;
+
+  std::size_t count = vsyncs_.load(std::memory_order_acquire);
+  std::chrono::duration<double> elapsed = now - refreshStart_;
+  double ratio = (count - refreshCount_) / elapsed.count() *
+                 kNtscFrameDuration.count();
+  followVsync_ = std::abs(ratio - 1) < kMaxRefreshDeviation;
+
+  refreshStart_ = now;
+  refreshCount_ = count;
+}
+
+void FramePacer::UpdateRate() {
+  if (speed_ != 1 || mode_ == TIMER || !speaker_) {
+    rateRatio_ = 1;
+    return;
+  }
+
+  double target =
+      kAudioLatencyFrames * speaker_->sampleRate() * kNtscFrameDuration.count();
+  double queued = static_cast<double>(speaker_->queuedSamples());
+  if (queueAverage_ < 0) queueAverage_ = queued;
+  queueAverage_ += (queued - queueAverage_) * kQueueAverageWeight;
+
+  // More samples while the queue is short, fewer while it is long
+  double delta = kMaxRateDelta * (target - queueAverage_) / target;
+  rateRatio_ = 1 + std::max(-kMaxRateDelta, std::min(delta, kMaxRateDelta));
+}
+
+}  // namespace hn
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+#include "PeripheralDevices.h"
+#include "common.h"
+
+namespace hn {
+
+// Decides when the emulator runs its next frame, one frame per wakeup.
+//
+// Frames are due at the NTSC rate, 60.0988Hz, on a timer that never runs one
+// early. TIMER runs them when due. AUDIO holds a due frame back while the
+// speaker queue has more than a few frames of samples. VSYNC runs it on the
+// first refresh of the display from when it is due, when the display
+// refreshes within 1% of the NES rate, and on the timer otherwise. Following
+// the audio or the display, the NES rate drifts from the speaker rate, so the
+// resampling rate is bent slightly to keep the queue where it should be.
+class FramePacer {
+ public:
+  enum Mode { TIMER, AUDIO, VSYNC };
+
+  FramePacer();
+
+  void setMode(Mode mode) { mode_ = mode; }
+  Mode mode() const { return mode_; }
+  // Runs factor times as fast as the NES, on the timer only
+  void setSpeed(int factor);
+  // The speaker followed in AUDIO mode, and whose rate is controlled
+  void setSpeaker(const VirtualSpeaker *speaker) { speaker_ = speaker; }
+
+  // Waits until the next frame is due
+  void Wait();
+  // Starts over from now, after the emulation stopped for a while
+  void Restart();
+
+  // Told by the display after every refresh, from any thread
+  void Vsync() {
+    lastVsync_.store(Clock::now().time_since_epoch().count(),
+                     std::memory_order_release);
+    vsyncs_.fetch_add(1, std::memory_order_release);
+  }
+
+  // Samples to make per sample of the speaker rate, around 1
+  double rateRatio() const { return rateRatio_; }
+
+ private:
+  using Clock = std::chrono::high_resolution_clock;
+
+  // Waits for the audio or the display, no later than the timeout
+  void WaitAudio(Clock::time_point timeout);
+  void WaitVsync(Clock::time_point timeout);
+  // Counts the refreshes of the display, to follow it only when it refreshes
+  // about as often as the NES
+  void MeasureRefresh(Clock::time_point now);
+  void UpdateRate();
+
+  Mode mode_;
+  int speed_;
+  Clock::duration period_;      // of a frame at the speed
+  Clock::time_point deadline_;  // when the next frame is due
+
+  const VirtualSpeaker *speaker_;
+  double queueAverage_;  // samples, smoothed over frames
+  double rateRatio_;
+
+  std::atomic<std::size_t> vsyncs_;
+  std::atomic<Clock::rep> lastVsync_;  // since the clock epoch
+  Clock::time_point refreshStart_;     // of the refreshes counted
+  std::size_t refreshCount_;
+  bool followVsync_;
+};
+
+}  // namespace hn
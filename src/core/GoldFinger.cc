@@ -1,7 +1,9 @@
 #include "GoldFinger.h"
 
+#include <cctype>
 #include <cstdlib>
 #include <fstream>
+#include <sstream>
 #include "glog/logging.h"
 namespace hn {
 
@@ -12,12 +14,20 @@ void GoldFinger::LoadFile(const std::string& filepath) {
     return;
   }
 
-  std::string addr;
-  int val;
-  char* p;
-  while (!ifs.eof()) {
-    ifs >> addr >> val;
+  std::string line;
+  while (std::getline(ifs, line)) {
+    std::istringstream ss(line);
+    std::string addr;
+    int val;
+    if (!(ss >> addr)) continue;
+    if (!(ss >> val)) {
+      if (!AddGameGenie(addr)) {
+        LOG(ERROR) << "GoldFinger can not read the line: " << line;
+      }
+      continue;
+    }
 
+    char* p;
     Address vaddr = strtol(addr.c_str(), &p, 16);
     VLOG(2) << "Address " << vaddr << " val: " << val;
 
@@ -28,30 +38,57 @@ void GoldFinger::LoadFile(const std::string& filepath) {
 void GoldFinger::Enable() {
   VLOG(2) << "GoldFinger enabled";
   working_ = true;
+  Apply();
 }
 
 void GoldFinger::Disable() {
   VLOG(2) << "GoldFinger disabled";
   working_ = false;
+  Apply();
 }
 
 void GoldFinger::Toggle() {
   working_ = !working_;
   VLOG(2) << "GoldFinger " << (working_ ? "enabled" : "disabled");
+  Apply();
 }
 
-void GoldFinger::Patrol() {
-  if (!working_) return;
+void GoldFinger::SetPatch(Address addr, Byte val) {
+  memory_patches_[addr] = {addr, val, -1};
+  VLOG(2) << "GoldFinger set memory patch at " << addr << " value as " << val;
+  Apply();
+}
 
-  for (auto memval : memory_patches_) {
-    // Write memval
-    bus_.write(memval.first, memval.second);
+// Reference:
+//
+//  https://www.nesdev.org/wiki/Game_Genie
+//
+bool GoldFinger::AddGameGenie(const std::string& code) {
+  static const std::string kLetters = "APZLGITYEOXUKSVN";
+
+  if (code.size() != 6 && code.size() != 8) return false;
+  int n[8];
+  for (size_t i = 0; i < code.size(); ++i) {
+    auto pos = kLetters.find(toupper(code[i]));
+    if (pos == std::string::npos) return false;
+    n[i] = static_cast<int>(pos);
   }
-}
 
-void GoldFinger::SetPatch(Address addr, Byte val) {
-  memory_patches_[addr] = val;
-  VLOG(2) << "GoldFinger set memory patch at " << addr << " value as " << val;
+  Address addr = 0x8000 | ((n[3] & 7) << 12) | ((n[5] & 7) << 8) |
+                 ((n[4] & 8) << 8) | ((n[2] & 7) << 4) | ((n[1] & 8) << 4) |
+                 (n[4] & 7) | (n[3] & 8);
+  int last = code.size() == 8 ? n[7] : n[5];
+  Byte val = ((n[1] & 7) << 4) | ((n[0] & 8) << 4) | (n[0] & 7) | (last & 8);
+  int compare = -1;
+  if (code.size() == 8) {
+    compare = ((n[7] & 7) << 4) | ((n[6] & 8) << 4) | (n[6] & 7) | (n[5] & 8);
+  }
+
+  memory_patches_[addr] = {addr, val, compare};
+  VLOG(2) << "GoldFinger Game Genie " << code << " patches " << addr
+          << " value as " << +val;
+  Apply();
+  return true;
 }
 
 void GoldFinger::ReleasePatch(Address addr) {
@@ -59,7 +96,18 @@ void GoldFinger::ReleasePatch(Address addr) {
   if (iter != memory_patches_.end()) {
     VLOG(2) << "GoldFinger release memory patch at " << addr;
     memory_patches_.erase(iter);
+    Apply();
+  }
+}
+
+void GoldFinger::Apply() {
+  std::vector<MainBus::ReadPatch> patches;
+  if (working_) {
+    for (auto& patch : memory_patches_) {
+      patches.push_back(patch.second);
+    }
   }
+  bus_.setReadPatches(patches);
 }
 
 }  // namespace hn
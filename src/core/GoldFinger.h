@@ -1,32 +1,39 @@
 #pragma once
 
-#include <unordered_map>
+#include <map>
 
 #include "MainBus.h"
 
 namespace hn {
 
+// Cheats, as read patches on the main bus: RAM patches pin a value, Game
+// Genie codes patch what the mapper reads from the PRG ROM. Nothing is done
+// while running, only the patched pages leave the fast path of the bus.
 class GoldFinger {
  public:
   GoldFinger(MainBus &bus);
 
+  // Lines of "address value", address in hex, or Game Genie codes
   void LoadFile(const std::string &filepath);
   void Enable();
   void Disable();
   void Toggle();
 
-  void Patrol();
-
   void SetPatch(Address addr, Byte val);
+  // Six or eight letters, false if it is not a Game Genie code
+  bool AddGameGenie(const std::string &code);
   void ReleasePatch(Address addr);
 
   bool IsWorking() const { return working_; }
 
  private:
+  // Hands the patches to the bus, none while disabled
+  void Apply();
+
   MainBus &bus_;
   bool working_;
 
-  std::unordered_map<Address, Byte> memory_patches_;
+  std::map<Address, MainBus::ReadPatch> memory_patches_;
 };
 
 }  // namespace hn
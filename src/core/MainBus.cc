@@ -73,22 +73,104 @@ constexpr size_t kPPMemEndAddr = 0x4000;     // 16KB
 constexpr size_t kExtRAMStartAddr = 0x6000;  // 24KB
 constexpr size_t kExtRAMEndAddr = 0x8000;    // 32KB
 
-constexpr Address kRAMMask = kRAMEndAddr - 1;  // 2KB
+constexpr Address kRAMMask = kRAMSize - 1;  // 2KB, mirrored up to 8KB
+
+MainBus::MainBus()
+    : RAM_(kRAMSize, 0),
+      mapper_(nullptr),
+      apu_(nullptr),
+      cpu_(nullptr),
+      ppu_(nullptr) {
+  std::fill(std::begin(patchPages_), std::end(patchPages_), -1);
+  updatePages();
+}
 
-MainBus::MainBus() : RAM_(kRAMSize, 0), mapper_(nullptr) {}
+void MainBus::updatePages() {
+  for (int page = 0; page < 0x80; ++page) {
+    Address addr = page << 8;
+    Byte *ptr = nullptr;
+    if (addr < kRAMEndAddr) {
+      ptr = &RAM_[addr & kRAMMask];
+    } else if (kExtRAMStartAddr <= addr && addr < kExtRAMEndAddr &&
+               mapper_ && mapper_->hasExtendedRAM() &&
+               extRAM_.size() >= kExtRAMSize) {
+      ptr = &extRAM_[addr - kExtRAMStartAddr];
+    }
+
+    memoryPages_[page] = writePages_[page] = ptr;
+    readPages_[page] = patchPages_[page] < 0 ? ptr : nullptr;
+  }
+
+  updatePRGPages();
+}
+
+// PRG windows are read only, writes keep going to the mapper registers
+void MainBus::updatePRGPages() {
+  for (int page = 0x80; page < 0x100; ++page) {
+    Address addr = page << 8;
+    const Byte *window = mapper_ ? mapper_->prgWindow(addr) : nullptr;
+
+    memoryPages_[page] = window ? window + (addr & 0x1fff) : nullptr;
+    readPages_[page] = patchPages_[page] < 0 ? memoryPages_[page] : nullptr;
+    writePages_[page] = nullptr;
+  }
+}
+
+void MainBus::setReadPatches(const std::vector<ReadPatch> &patches) {
+  patchSlots_.clear();
+  std::fill(std::begin(patchPages_), std::end(patchPages_), -1);
+
+  auto add = [this](Address addr, const ReadPatch &patch) {
+    int &start = patchPages_[addr >> 8];
+    if (start < 0) {
+      start = patchSlots_.size();
+      patchSlots_.resize(start + 0x100, PatchSlot());
+    }
+    patchSlots_[start + (addr & 0xff)] = {true, patch.value, patch.compare};
+  };
+
+  for (auto &patch : patches) {
+    if (patch.addr < kRAMEndAddr) {
+      for (Address addr = patch.addr & kRAMMask; addr < kRAMEndAddr;
+           addr += kRAMSize) {
+        add(addr, patch);
+      }
+    } else {
+      add(patch.addr, patch);
+    }
+  }
+
+  updatePages();
+}
+
+Byte MainBus::readUnmapped(Address addr) {
+  if (patchPages_[addr >> 8] >= 0) {
+    return readPatched(addr);
+  }
+  return readDevices(addr);
+}
+
+Byte MainBus::readPatched(Address addr) {
+  const Byte *page = memoryPages_[addr >> 8];
+  Byte value = page ? page[addr & 0xff] : readDevices(addr);
+
+  auto &slot = patchSlots_[patchPages_[addr >> 8] + (addr & 0xff)];
+  if (slot.set && (slot.compare < 0 || slot.compare == value)) {
+    return slot.value;
+  }
+  return value;
+}
+
+Byte MainBus::readDevices(Address addr) {
+  if (addr < 0x4020) {
+    if (syncCallback_) syncCallback_();
 
-Byte MainBus::read(Address addr) {
-  if (addr < kRAMEndAddr) {
-    return RAM_[addr & kRAMMask];
-  } else if (addr < 0x4020) {
     if (addr < kPPMemEndAddr) {
       // PPU registers, mirrored
 
-      auto it = readCallbacks_.find(static_cast<IORegisters>(addr & 0x2007));
-      if (it != readCallbacks_.end()) {
-        return (it->second)();
-        // Second object is the pointer to the function object
-        // Dereference the function pointer and call it
+      auto &callback = readCallbacks_[ioSlot(addr)];
+      if (callback) {
+        return callback();
       } else {
         VLOG(2) << "No read callback registered for I/O register at: "
                 << std::hex << +addr;
@@ -97,11 +179,9 @@ Byte MainBus::read(Address addr) {
       // Only *some* IO registers
       // OAMDMA & 2 JOYS
 
-      auto it = readCallbacks_.find(static_cast<IORegisters>(addr));
-      if (it != readCallbacks_.end()) {
-        return (it->second)();
-        // Second object is the pointer to the function object
-        // Dereference the function pointer and call it
+      auto &callback = readCallbacks_[ioSlot(addr)];
+      if (callback) {
+        return callback();
       } else {
         VLOG(2) << "No read callback registered for I/O register at: "
                 << std::hex << +addr;
@@ -113,9 +193,7 @@ Byte MainBus::read(Address addr) {
   } else if (addr < kExtRAMStartAddr) {
     VLOG(2) << "Expansion ROM read attempted. This is currently unsupported";
   } else if (addr < kExtRAMEndAddr) {
-    if (mapper_->hasExtendedRAM()) {
-      return extRAM_[addr - kExtRAMStartAddr];
-    }
+    // Ext RAM is in the page tables when present
   } else {
     // Which addr is greater 0x8000.
     return mapper_->readPRG(addr);
@@ -128,17 +206,15 @@ Address MainBus::readAddress(Address addr) {
   return read(addr) | read(addr + 1) << 8;
 }
 
-void MainBus::write(Address addr, Byte value) {
-  if (addr < kRAMEndAddr) {
-    RAM_[addr & kRAMMask] = value;
-  } else if (addr < 0x4020) {
+void MainBus::writeUnmapped(Address addr, Byte value) {
+  if (addr < 0x4020) {
+    if (syncCallback_) syncCallback_();
+
     if (addr < kPPMemEndAddr) {
       // PPU registers, mirrored
-      auto it = writeCallbacks_.find(static_cast<IORegisters>(addr & 0x2007));
-      if (it != writeCallbacks_.end()) {
-        (it->second)(value);
-        // Second object is the pointer to the function object
-        // Dereference the function pointer and call it
+      auto &callback = writeCallbacks_[ioSlot(addr)];
+      if (callback) {
+        callback(value);
       } else {
         VLOG(2) << "No write callback registered for I/O register at: "
                 << std::hex << +addr;
@@ -147,11 +223,9 @@ void MainBus::write(Address addr, Byte value) {
       // only some registers
       // OAMDMA & 2 JOYS
 
-      auto it = writeCallbacks_.find(static_cast<IORegisters>(addr));
-      if (it != writeCallbacks_.end()) {
-        (it->second)(value);
-        // Second object is the pointer to the function object
-        // Dereference the function pointer and call it
+      auto &callback = writeCallbacks_[ioSlot(addr)];
+      if (callback) {
+        callback(value);
       } else {
         VLOG(2) << "No write callback registered for I/O register at: "
                 << std::hex << +addr;
@@ -163,32 +237,27 @@ void MainBus::write(Address addr, Byte value) {
   } else if (addr < kExtRAMStartAddr) {
     VLOG(2) << "Expansion ROM access attempted. This is currently unsupported";
   } else if (addr < kExtRAMEndAddr) {
-    if (mapper_->hasExtendedRAM()) {
-      extRAM_[addr - kExtRAMStartAddr] = value;
-    }
+    // Ext RAM is in the page tables when present
   } else {
     // Which addr is greater 0x8000.
+    if (syncCallback_) syncCallback_();
+
     mapper_->writePRG(addr, value);
   }
 }
 
 const Byte *MainBus::getPagePtr(Byte page) {
   Address addr = page << 8;
-  if (addr < kRAMEndAddr) {
-    return &RAM_[addr & kRAMMask];
+  if (memoryPages_[page]) {
+    // RAM, ext RAM and PRG windows
+    return memoryPages_[page];
   } else if (addr < 0x4020) {
     LOG(ERROR) << "Register address memory pointer access attempt";
-  } else if (addr < kExtRAMStartAddr) {
-    LOG(ERROR) << "Expansion ROM access attempted, which is unsupported";
   } else if (addr < kExtRAMEndAddr) {
-    if (mapper_->hasExtendedRAM()) {
-      return &extRAM_[addr - kExtRAMStartAddr];
-    }
     LOG(ERROR) << "Expansion ROM access attempted, which is unsupported";
   } else {
-    // Get page pointer from cartridge
-    LOG(ERROR) << "Unknown address " << std::hex << addr
-               << " memory pointer access attempt";
+    LOG(ERROR) << "Mapper does not map PRG address " << std::hex << addr
+               << ", memory pointer access attempt";
   }
 
   return nullptr;
@@ -242,6 +311,7 @@ bool MainBus::setMapper(Mapper *mapper) {
   if (mapper->hasExtendedRAM()) {
     extRAM_.resize(kExtRAMSize);
   }
+  updatePages();
 
   return true;
 }
@@ -252,7 +322,13 @@ bool MainBus::setWriteCallback(IORegisters reg,
     LOG(ERROR) << "callback argument is nullptr";
     return false;
   }
-  return writeCallbacks_.emplace(reg, callback).second;
+
+  auto &slot = writeCallbacks_[ioSlot(reg)];
+  if (slot) {
+    return false;
+  }
+  slot = callback;
+  return true;
 }
 
 bool MainBus::setReadCallback(IORegisters reg,
@@ -261,7 +337,17 @@ bool MainBus::setReadCallback(IORegisters reg,
     LOG(ERROR) << "callback argument is nullptr";
     return false;
   }
-  return readCallbacks_.emplace(reg, callback).second;
+
+  auto &slot = readCallbacks_[ioSlot(reg)];
+  if (slot) {
+    return false;
+  }
+  slot = callback;
+  return true;
+}
+
+void MainBus::setSyncCallback(std::function<void(void)> callback) {
+  syncCallback_ = callback;
 }
 
 std::string MainBus::getPageContent(Address page) {
@@ -290,6 +376,7 @@ void MainBus::Reset() {
     extRAM_.resize(kExtRAMSize);
     std::fill(extRAM_.begin(), extRAM_.end(), 0);
   }
+  updatePages();
 }
 
 void MainBus::Tick() { mapper_->Tick(); }
@@ -302,5 +389,21 @@ void MainBus::Save(std::ostream &os) {
 void MainBus::Restore(std::istream &is) {
   Read(is, RAM_);
   Read(is, extRAM_);
+  updatePages();
+}
+
+void MainBus::SnapshotTo(StateBuffer &buffer) {
+  buffer.Put(RAM_);
+  buffer.Put(extRAM_);
+}
+void MainBus::RestoreFrom(StateBuffer &buffer) {
+  buffer.Get(RAM_);
+  buffer.Get(extRAM_);
+  updatePages();
+}
+
+void MainBus::Hash(StateHash &hash) const {
+  hash.Update(RAM_);
+  hash.Update(extRAM_);
 }
 };  // namespace hn
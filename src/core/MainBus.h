@@ -2,11 +2,11 @@
 
 #include <functional>
 #include <memory>
-#include <unordered_map>
 #include <vector>
 
 #include "../mapper/Mapper.h"
 #include "Cartridge.h"
+#include "StateHash.h"
 
 namespace hn {
 enum IORegisters {
@@ -25,22 +25,53 @@ enum IORegisters {
   JOY2 = 0x4017,
 };
 
+// PPU registers take the first 8 slots, the $40xx ones the following 32
+constexpr int kIORegisterSlots = 8 + 0x20;
+
 class APU;
 class CPU;
 class PPU;
 class MainBus : public Serialize {
  public:
+  // Reads of addr give value instead of what is behind it, when that equals
+  // compare or compare is negative. Writes are not affected
+  struct ReadPatch {
+    Address addr;
+    Byte value;
+    int compare;
+  };
+
   MainBus();
-  Byte read(Address addr);
+  // Pages backed by memory are accessed through the page tables, the rest
+  // (I/O registers and mapper) take the slow path
+  Byte read(Address addr) {
+    const Byte *page = readPages_[addr >> 8];
+    return page ? page[addr & 0xff] : readUnmapped(addr);
+  }
   Address readAddress(Address addr);
-  void write(Address addr, Byte value);
+  void write(Address addr, Byte value) {
+    Byte *page = writePages_[addr >> 8];
+    if (page) {
+      page[addr & 0xff] = value;
+    } else {
+      writeUnmapped(addr, value);
+    }
+  }
   bool setMapper(Mapper *mapper);
   bool setAPU(APU *apu);
   bool setCPU(CPU *cpu);
   bool setPPU(PPU *ppu);
   bool setWriteCallback(IORegisters reg, std::function<void(Byte)> callback);
   bool setReadCallback(IORegisters reg, std::function<Byte(void)> callback);
+  // Called before any access that other devices could observe: I/O registers
+  // and mapper registers
+  void setSyncCallback(std::function<void(void)> callback);
+  // Pages without patches stay in the page tables, they cost nothing
+  void setReadPatches(const std::vector<ReadPatch> &patches);
+  // Memory behind the page, patches are not applied
   const Byte *getPagePtr(Byte page);
+  // Called by the mapper once it switched PRG banks
+  void updatePRGPages();
 
   CPU *cpu() const;
   PPU *ppu() const;
@@ -53,8 +84,23 @@ class MainBus : public Serialize {
 
   virtual void Save(std::ostream &os) override;
   virtual void Restore(std::istream &is) override;
+  virtual void SnapshotTo(StateBuffer &buffer) override;
+  virtual void RestoreFrom(StateBuffer &buffer) override;
+  // RAM and extended RAM
+  void Hash(StateHash &hash) const;
 
  private:
+  Byte readUnmapped(Address addr);
+  Byte readPatched(Address addr);
+  Byte readDevices(Address addr);
+  void writeUnmapped(Address addr, Byte value);
+  // Rebuilds the page tables, whenever the memory behind them may move
+  void updatePages();
+
+  static int ioSlot(Address addr) {
+    return addr < 0x4000 ? (addr & 0x7) : 8 + (addr & 0x1f);
+  }
+
   Memory RAM_;
   Memory extRAM_;
   Mapper *mapper_;
@@ -62,8 +108,22 @@ class MainBus : public Serialize {
   CPU *cpu_;
   PPU *ppu_;
 
-  std::unordered_map<IORegisters, std::function<void(Byte)>> writeCallbacks_;
-  std::unordered_map<IORegisters, std::function<Byte(void)>> readCallbacks_;
+  const Byte *readPages_[0x100];
+  Byte *writePages_[0x100];
+  const Byte *memoryPages_[0x100];  // read pages before taking out patches
+
+  struct PatchSlot {
+    bool set;
+    Byte value;
+    int compare;
+  };
+  // 0x100 slots for each patched page, patchPages_ has where they start
+  std::vector<PatchSlot> patchSlots_;
+  int patchPages_[0x100];
+
+  std::function<void(Byte)> writeCallbacks_[kIORegisterSlots];
+  std::function<Byte(void)> readCallbacks_[kIORegisterSlots];
+  std::function<void(void)> syncCallback_;
 };
 
 }  // namespace hn
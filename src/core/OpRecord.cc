@@ -1,93 +1,241 @@
 #include "OpRecord.h"
 
-#include <fstream>
-
+#include "StateDelta.h"
 #include "glog/logging.h"
 
 namespace hn {
 
-OperatingRecord::OperatingRecord() : joypad_record_(2) {}
+constexpr uint32_t kRecordMark = 0x1a524e48;
+// The mark, the players and the frame count
+constexpr std::streamoff kFramesOffset = 2 * sizeof(uint32_t);
+constexpr std::streamoff kHeaderSize = kFramesOffset + sizeof(uint64_t);
+
+OperatingRecord::OperatingRecord() : savedFrames_(0) {}
 
-void OperatingRecord::Record(int player, size_t cycle, Byte code) {
-  joypad_record_[player].emplace(cycle);
+OperatingRecord::~OperatingRecord() { Flush(); }
+
+void OperatingRecord::Record(size_t frame, const Byte *buttons) {
+  savedFrames_ = std::min(savedFrames_, std::min(frame, frames()));
+  log_.resize(frame * kPlayers, 0);
+  log_.insert(log_.end(), buttons, buttons + kPlayers);
 }
 
-Byte OperatingRecord::Read(int player, size_t cycle) const {
-  if (cycle > top_cycle_) {
+void OperatingRecord::Read(size_t frame, Byte *buttons) const {
+  if (frame >= frames()) {
+    std::fill(buttons, buttons + kPlayers, 0);
     if (finish_event_) finish_event_();
-    return 0x40;
+    return;
   }
 
-  auto &record = joypad_record_[player];
-  auto iter = record.find(cycle);
-  if (iter != record.end()) {
-    return 0x41;
+  std::copy_n(&log_[frame * kPlayers], kPlayers, buttons);
+}
+
+void OperatingRecord::Truncate(size_t frame) {
+  savedFrames_ = std::min(savedFrames_, frame);
+  if (frame < frames()) {
+    log_.resize(frame * kPlayers);
   }
 
-  return 0x40;
+  while (!keyframes_.empty() && keyframes_.back().frame >= frame) {
+    PopKeyframe();
+  }
+  while (!checks_.empty() && checks_.back().frame >= frame) {
+    checks_.pop_back();
+  }
 }
 
-void OperatingRecord::Load(const std::string &path) {
-  std::ifstream file(path, std::ios::in | std::ios::binary);
-  Restore(file);
-  file.close();
+void OperatingRecord::AddKeyframe(size_t frame, const StateBuffer &state) {
+  while (!keyframes_.empty() && keyframes_.back().frame >= frame) {
+    PopKeyframe();
+  }
 
-  LOG(INFO) << "Load record done! " << joypad_record_.size()
-            << " Players, and joy1 acts " << joypad_record_[0].size()
-            << " joy2 acts " << joypad_record_[1].size();
+  keyframes_.push_back({frame, state.size(), Memory()});
+  EncodeDelta(state.data(), state.size(), lastKeyframe_, diff_,
+              keyframes_.back().delta);
+  lastKeyframe_.assign(state.data(), state.data() + state.size());
+}
 
-  file_path_ = path;
+void OperatingRecord::PopKeyframe() {
+  const Keyframe &key = keyframes_.back();
+  size_t before =
+      keyframes_.size() > 1 ? keyframes_[keyframes_.size() - 2].size : 0;
+  lastKeyframe_.resize(std::max(lastKeyframe_.size(), before), 0);
+  DecodeDelta(key.delta.data(), key.delta.size(), lastKeyframe_);
+  lastKeyframe_.resize(before);
+  keyframes_.pop_back();
 }
 
-void OperatingRecord::Save() { Save(file_path_); }
+size_t OperatingRecord::FindKeyframe(size_t frame, StateBuffer &state) const {
+  auto iter = std::lower_bound(
+      keyframes_.begin(), keyframes_.end(), frame,
+      [](const Keyframe &key, size_t frame) { return key.frame < frame; });
+  if (iter == keyframes_.begin()) {
+    return static_cast<size_t>(-1);
+  }
 
-void OperatingRecord::Save(const std::string &path) {
-  std::ofstream file(path, std::ios::out | std::ios::binary);
-  Save(file);
-  file.close();
+  // Applies the deltas from the first keyframe on
+  Memory key;
+  for (auto delta = keyframes_.begin(); delta != iter; ++delta) {
+    key.resize(std::max(key.size(), delta->size), 0);
+    DecodeDelta(delta->delta.data(), delta->delta.size(), key);
+    key.resize(delta->size);
+  }
 
-  LOG(INFO) << "Load save done! " << joypad_record_.size()
-            << " Players, and joy1 acts " << joypad_record_[0].size()
-            << " joy2 acts " << joypad_record_[1].size();
-  file_path_ = path;
+  --iter;
+  state.Assign(key.data(), key.size());
+  return iter->frame;
 }
 
-void OperatingRecord::Save(std::ostream &os) {
-  WriteNum(os, joypad_record_.size());
-  WriteNum(os, joypad_record_[0].size());
-  WriteNum(os, joypad_record_[1].size());
-  WriteLNum(os, top_cycle_);
+void OperatingRecord::AddCheck(size_t frame, uint64_t hash) {
+  while (!checks_.empty() && checks_.back().frame >= frame) {
+    checks_.pop_back();
+  }
+
+  checks_.push_back({frame, hash});
+}
+
+bool OperatingRecord::FindCheck(size_t frame, uint64_t &hash) const {
+  auto iter = std::lower_bound(
+      checks_.begin(), checks_.end(), frame,
+      [](const Check &check, size_t frame) { return check.frame < frame; });
+  if (iter == checks_.end() || iter->frame != frame) {
+    return false;
+  }
 
-  for (int i = 0; i < 2; i++) {
-    for (auto rcd : joypad_record_[i]) {
-      WriteLNum(os, rcd);
-    }
+  hash = iter->hash;
+  return true;
+}
+
+size_t OperatingRecord::length() const {
+  return checks_.empty() ? frames()
+                         : std::max<size_t>(frames(), checks_.back().frame + 1);
+}
+
+bool OperatingRecord::Open(const std::string &path) {
+  file_.close();
+  file_.open(path, std::ios::in | std::ios::out | std::ios::binary |
+                       std::ios::trunc);
+  if (!file_.is_open()) {
+    LOG(ERROR) << "Failed to create record file: " << path;
+    return false;
   }
+
+  WriteNum(file_, kRecordMark);
+  WriteNum(file_, kPlayers);
+  WriteLNum(file_, 0);
+  savedFrames_ = 0;
+  Flush();
+  return true;
+}
+
+void OperatingRecord::Flush() {
+  if (!file_.is_open()) return;
+
+  // What is in the file past the frame count is left over from before going
+  // back in time, it is overwritten as the recording goes on
+  file_.seekp(kHeaderSize + savedFrames_ * kPlayers);
+  file_.write(reinterpret_cast<const char *>(log_.data()) +
+                  savedFrames_ * kPlayers,
+              (frames() - savedFrames_) * kPlayers);
+  file_.seekp(kFramesOffset);
+  WriteLNum(file_, frames());
+  file_.flush();
+  if (!file_) {
+    LOG(ERROR) << "Failed to write record file";
+    file_.close();
+    return;
+  }
+
+  savedFrames_ = frames();
+}
+
+bool OperatingRecord::Load(const std::string &path) {
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  if (ReadNum(file) != kRecordMark || !file) {
+    return false;
+  }
+  if (ReadNum(file) != kPlayers) {
+    LOG(ERROR) << "Mismatch players of record file: " << path;
+    return false;
+  }
+
+  log_.resize(ReadLNum(file) * kPlayers);
+  file.read(reinterpret_cast<char *>(log_.data()), log_.size());
+  // Cut short if the last flush did not make it
+  log_.resize(file.gcount() / kPlayers * kPlayers);
+  keyframes_.clear();
+  lastKeyframe_.clear();
+  checks_.clear();
+
+  LOG(INFO) << "Load record done! " << frames() << " frames";
+  return true;
+}
+
+void OperatingRecord::Save(std::ostream &os) {
+  WriteNum(os, kPlayers);
+  Write(os, log_);
+  Write(os, checks_);
 }
 
 void OperatingRecord::Restore(std::istream &is) {
   auto size = ReadNum(is);
-  if (size != 2) {
+  if (size != kPlayers) {
     LOG(ERROR) << "Mismatch size: " << size;
     return;
   }
 
-  joypad_record_.resize(2);
-  joypad_record_[0].clear();
-  joypad_record_[1].clear();
+  Serialize::Read(is, log_);
+  Serialize::Read(is, checks_);
+}
+
+void OperatingRecord::SaveKeyframes(std::ostream &os) {
+  std::vector<uint64_t> offsets;
+  for (auto &key : keyframes_) {
+    offsets.push_back(os.tellp());
+    Write(os, key.delta);
+  }
+
+  uint64_t index = os.tellp();
+  WriteNum(os, keyframes_.size());
+  for (size_t i = 0; i < keyframes_.size(); ++i) {
+    WriteLNum(os, keyframes_[i].frame);
+    WriteLNum(os, keyframes_[i].size);
+    WriteLNum(os, offsets[i]);
+  }
+  WriteLNum(os, index);
+}
+
+void OperatingRecord::RestoreKeyframes(std::istream &is) {
+  keyframes_.clear();
+  lastKeyframe_.clear();
+
+  is.seekg(-static_cast<std::streamoff>(sizeof(uint64_t)), std::ios::end);
+  is.seekg(ReadLNum(is));
+  uint32_t count = ReadNum(is);
+  std::vector<uint64_t> offsets(count);
+  keyframes_.resize(count);
+  for (uint32_t i = 0; i < count && is; ++i) {
+    keyframes_[i].frame = ReadLNum(is);
+    keyframes_[i].size = ReadLNum(is);
+    offsets[i] = ReadLNum(is);
+  }
 
-  auto size1 = ReadNum(is);
-  size = ReadNum(is);
-  top_cycle_ = ReadLNum(is);
+  for (uint32_t i = 0; i < count && is; ++i) {
+    is.seekg(offsets[i]);
+    Serialize::Read(is, keyframes_[i].delta);
+  }
 
-  while (size1-- > 0) {
-    size_t cycle = ReadLNum(is);
-    joypad_record_[0].emplace(cycle);
+  if (!is) {
+    LOG(ERROR) << "Broken keyframes, the replay can only start from the "
+                  "beginning";
+    keyframes_.clear();
+    return;
   }
 
-  while (size-- > 0) {
-    size_t cycle = ReadLNum(is);
-    joypad_record_[1].emplace(cycle);
+  for (auto &key : keyframes_) {
+    lastKeyframe_.resize(std::max(lastKeyframe_.size(), key.size), 0);
+    DecodeDelta(key.delta.data(), key.delta.size(), lastKeyframe_);
+    lastKeyframe_.resize(key.size);
   }
 }
 
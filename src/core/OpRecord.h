@@ -1,23 +1,62 @@
 #pragma once
 
+#include <fstream>
 #include <functional>
-#include <set>
 #include <vector>
 
 #include "common.h"
 
 namespace hn {
 
+// Joypad inputs, one byte per joypad per frame with bit n for button n.
+// Recordings are saved in the save documents of the emulator, and streamed
+// to a record file while they go on: a short header with the frame count,
+// followed by the frames.
+//
+// Keyframes are snapshots of the machine taken every so often while
+// recording, so a replay can start from any frame without emulating all the
+// ones before it. Each one is kept as its delta against the keyframe before,
+// see StateDelta.h, and only the last one whole.
 class OperatingRecord : public Serialize {
  public:
+  static constexpr int kPlayers = 2;
+
   OperatingRecord();
+  ~OperatingRecord();
+
+  // Records the buttons of every joypad for the frame. The frames in between
+  // are filled with no button held, the ones after are forgotten
+  void Record(size_t frame, const Byte* buttons);
+  // Past the end of the recording no button is held, and the finish
+  // callback is called
+  void Read(size_t frame, Byte* buttons) const;
+
+  size_t frames() const { return log_.size() / kPlayers; }
+  // Forgets the frames from this one on, when going back in time
+  void Truncate(size_t frame);
 
-  void Record(int player, size_t cycle, Byte code);
-  Byte Read(int player, size_t cycle) const;
+  // Keeps the snapshot taken at the start of the frame, the keyframes from
+  // this frame on are forgotten
+  void AddKeyframe(size_t frame, const StateBuffer& state);
+  // Takes the last keyframe before the frame, returns the frame it was taken
+  // at or -1 if there is none
+  size_t FindKeyframe(size_t frame, StateBuffer& state) const;
+  size_t keyframes() const { return keyframes_.size(); }
 
-  void Load(const std::string& path);
-  void Save(const std::string& path);
-  void Save();
+  // Hashes of the machine at some frames, that replays are checked against
+  void AddCheck(size_t frame, uint64_t hash);
+  bool FindCheck(size_t frame, uint64_t& hash) const;
+  // Frames the recording goes on for, with inputs or checks
+  size_t length() const;
+
+  // Writes the recording to a new record file, and the frames recorded later
+  // on every flush
+  bool Open(const std::string& path);
+  // Writes what changed since the last flush, from the first frame recorded
+  // again after going back in time
+  void Flush();
+  // Takes the inputs of a record file, false if it is not one
+  bool Load(const std::string& path);
 
   void setFinishCallback(std::function<void()> finish) {
     finish_event_ = finish;
@@ -25,13 +64,34 @@ class OperatingRecord : public Serialize {
 
   virtual void Save(std::ostream& os) override;
   virtual void Restore(std::istream& is) override;
-
-  void setTopCycle(size_t tc) { top_cycle_ = tc; }
+  // The keyframe deltas are followed by their index, and the position of the
+  // index ends the stream
+  void SaveKeyframes(std::ostream& os);
+  void RestoreKeyframes(std::istream& is);
 
  private:
-  std::vector<std::set<size_t>> joypad_record_;
-  std::string file_path_;
-  size_t top_cycle_;
+  struct Keyframe {
+    size_t frame;
+    size_t size;  // of the state
+    Memory delta;
+  };
+
+  // Drops the last keyframe, going back to the state of the one before
+  void PopKeyframe();
+
+  struct Check {
+    uint64_t frame;
+    uint64_t hash;
+  };
+
+  Memory log_;
+  std::vector<Keyframe> keyframes_;  // by frame
+  Memory lastKeyframe_;              // state of the last one
+  Memory diff_;
+  std::vector<Check> checks_;        // by frame
+
+  std::fstream file_;
+  size_t savedFrames_;  // the same in the file
 
   std::function<void()> finish_event_;
 };
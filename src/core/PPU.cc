@@ -1,5 +1,6 @@
 #include "PPU.h"
 
+#include <algorithm>
 #include <cstring>
 #include <ios>
 #include <ostream>
@@ -52,9 +53,13 @@ PPU::PPU(MainBus &mainBus, PictureBus &bus)
     : mainBus_(mainBus),
       bus_(bus),
       screen_(nullptr),
+      frameSkip_(0),
+      frameSkipPeriod_(0),
+      pictureHidden_(false),
+      drawInterval_(0),
+      skipFrame_(false),
       spriteMemory_(64 * 4),
-      pictureBuffer_(ScanlineVisibleDots,
-                     std::vector<Color>(VisibleScanlines, 0x24)) {}
+      pictureBuffer_(ScanlineVisibleDots * VisibleScanlines, 0x24) {}
 
 void PPU::Reset() {
 #ifdef PPUCONTROL_IN_BYTE
@@ -72,6 +77,7 @@ void PPU::Reset() {
   showEdgeSprites_ = true;
   showBackground_ = true;
   showSprites_ = true;
+  emphasis_ = 0;
 #endif  // PPUMASK_IN_BYTE
 
   evenFrame_ = firstWrite_ = true;
@@ -82,8 +88,9 @@ void PPU::Reset() {
   vblank_ = false;
 #endif  // PPUSTATUS_IN_BYTE
   dataAddress_ = cycle_ = scanline_ = oamDataAddress_ = fineXScroll_ =
-      tempAddress_ = 0;
+      tempAddress_ = renderedX_ = 0;
   frameIndex_ = 0;
+  SetFrameSkip(frameSkip_, frameSkipPeriod_);
 
   dataAddrIncrement_ = 1;
   pipelineState_ = PreRender;
@@ -116,6 +123,23 @@ void PPU::Step() {
   ++cycle_;
 }
 
+void PPU::Run(int dots) {
+  for (; dots > 0; --dots) {
+    Step();
+  }
+}
+
+int PPU::DotsToEvent() const {
+  // Hsync happens at dot 256, state transitions and NMI at the end of line
+  if (cycle_ <= ScanlineVisibleDots) {
+    return ScanlineVisibleDots - cycle_ + 1;
+  } else if (cycle_ < ScanlineEndCycle - 1) {
+    return ScanlineEndCycle - cycle_;
+  }
+
+  return 1;
+}
+
 void PPU::vBlank() {
   if (cycle_ >= ScanlineEndCycle) {
     // If cycle_ is greater then 339, the scanline increases.
@@ -129,7 +153,27 @@ void PPU::vBlank() {
     scanline_ = 0;
     evenFrame_ = !evenFrame_;
     frameIndex_++;
+    updateSkipFrame();
+  }
+}
+
+void PPU::updateSkipFrame() {
+  if (drawInterval_ > 0 && (frameIndex_ + 1) % drawInterval_ == 0) {
+    skipFrame_ = false;
+    return;
   }
+
+  skipFrame_ =
+      pictureHidden_ ||
+      (frameSkipPeriod_ > 0 &&
+       static_cast<int>(frameIndex_ % frameSkipPeriod_) < frameSkip_);
+}
+
+void PPU::SetFrameSkip(int skip, int period) {
+  frameSkip_ = skip;
+  frameSkipPeriod_ = period;
+  // Takes effect from the next frame
+  skipFrame_ = false;
 }
 
 void PPU::preRender() {
@@ -157,14 +201,15 @@ void PPU::preRender() {
   // if rendering is on, every other frame is one cycle shorter (340 or 339)
   if (cycle_ >= ScanlineEndCycle - (!evenFrame_ && doubleShow)) {
     pipelineState_ = Render;
-    cycle_ = scanline_ = 0;
+    cycle_ = scanline_ = renderedX_ = 0;
   }
 }
 
 void PPU::render() {
-  if (cycle_ > 0 && cycle_ <= ScanlineVisibleDots) {
-    // If cycle_ is between 0 and 256, it indicates rendering in scanline.
-    renderInScanline();
+  if (cycle_ == ScanlineVisibleDots) {
+    // Pixels of the dots up to 256 are pending, finish the scanline before
+    // the scroll updates below
+    renderScanline(ScanlineVisibleDots);
   } else if (cycle_ == ScanlineVisibleDots + 1 && SHOW_BACKGROUND()) {
     // If cycle_ is 257
     if (TEST_BITS(dataAddress_, 0x7000)) {    // if fine Y < 7
@@ -208,7 +253,7 @@ void PPU::render() {
     }
 
     ++scanline_;
-    cycle_ = 0;
+    cycle_ = renderedX_ = 0;
   }
 
   if (cycle_ == 256) {
@@ -235,7 +280,7 @@ void PPU::postRender() {
   cycle_ = 0;
   pipelineState_ = VerticalBlank;
 
-  imageOutput();
+  if (!skipFrame_) imageOutput();
 
   // Should technically be done at first dot of VBlank, but this is close
   // enough
@@ -251,149 +296,261 @@ void PPU::postRender() {
 
 void PPU::imageOutput() {
   if (screen_) {
-    for (int x = 0; x < pictureBuffer_.size(); ++x) {
-      for (int y = 0; y < pictureBuffer_[0].size(); ++y) {
-        screen_->setPixel(x, y, pictureBuffer_[x][y]);
-      }
-    }
+    // Greyscale and emphasis as they are at the end of the frame
+#ifdef PPUMASK_IN_BYTE
+    Byte mask = ppu_mask_;
+#else   // PPUMASK_IN_BYTE
+    Byte mask = emphasis_ | greyscaleMode_;
+#endif  // PPUMASK_IN_BYTE
+    screen_->setFrame(pictureBuffer_.data(), ScanlineVisibleDots,
+                      VisibleScanlines, mask);
+  }
+}
+
+void PPU::SyncRender() {
+  if (pipelineState_ == Render && cycle_ > 1) {
+    // Dots before cycle_ have been stepped already
+    renderScanline(std::min(cycle_ - 1, ScanlineVisibleDots));
   }
 }
 
-void PPU::renderInScanline() {
 #define READ_PIXEL(addr, offset) \
   (((read(addr) >> offset) & 1) | (((read(addr + 8) >> offset) & 1) << 1))
 
-  Byte bgColor = 0, sprColor = 0;
-  bool bgOpaque = false, sprOpaque = true;
-  bool spriteForeground = false;
-
-  int x = cycle_ - 1;
-  int y = scanline_;
-
-  if (SHOW_BACKGROUND()) {
-    auto x_fine = 7 - ((fineXScroll_ + x) & 7);
-    if (SHOW_EDGE_BACKGROUND() || x >= 8) {
-      // fetch tile
-      Address addr = 0x2000 | (dataAddress_ & 0x0FFF);  // mask off fine y
-      Address tile = static_cast<Address>(read(addr));
-      // auto addr = 0x2000 + x / 8 + (y / 8) * (ScanlineVisibleDots / 8);
-
-      // fetch pattern
-      // Each pattern occupies 16 bytes, so multiply by 16
-      //
-      //    Character   Colors      Contents of Pattern Table
-      //    ...*....    00010000    00010000 $10  +-> 00000000 $00
-      //    ..O.O...    00202000    00000000 $00  |   00101000 $28
-      //    .#...#..    03000300    01000100 $44  |   01000100 $44
-      //    O.....O.    20000020    00000000 $00  |   10000010 $82
-      //    *******. -> 11111110 -> 11111110 $FE  |   00000000 $00
-      //    O.....O.    20000020    00000000 $00  |   10000010 $82
-      //    #.....#.    30000030    10000010 $82  |   10000010 $82
-      //    ........    00000000    00000000 $00  |   00000000 $00
-      //                                +---------+
-      //
-      // Add fine y /* dataAddress_  y % 8*/
-      // set whether the pattern is in the high or low page
-      addr = (tile << 4) | ((dataAddress_ >> 12) & 0x7);
-      if (HIGH_BG_PAGE()) addr |= 1 << 12;
-      // Get the corresponding bit determined by x_fine from the right
-      bgColor = READ_PIXEL(addr, x_fine);
-
-      // flag used to calculate final pixel with the sprite pixel
-      bgOpaque = bgColor;
-
-      //
-      //    Attribute Tables
-      //   +--------------+----------------+
-      //   |(0,0)  (1,0) 0|  (2,0)  (3,0) 1|
-      //   |(0,1)  (1,1)  |  (2,1)  (3,1)  |
-      //   +--------------+----------------+
-      //   |(0,2)  (1,2) 2|  (2,2)  (3,2) 3|
-      //   |(0,3)  (1,3)  |  (2,3)  (3,3)  |
-      //   +--------------+----------------+
-      //
-      // fetch attribute and calculate higher two bits of palette
-      // Attribute table start address is 0x23c0.
-      addr = 0x23C0 | (dataAddress_ & 0x0C00) | ((dataAddress_ >> 4) & 0x38) |
-             ((dataAddress_ >> 2) & 0x07);
-      auto attribute = read(addr);
-      int shift = ((dataAddress_ >> 4) & 4) | (dataAddress_ & 2);
-      // Extract and set the upper two bits for the color
-      bgColor |= ((attribute >> shift) & 0x3) << 2;
-    }
-    // Increment/wrap coarse X
-    if (!x_fine) {
-      if (TEST_BITS(dataAddress_, 0x001F)) {  // if coarse X == 31
-        CLR_BIT(dataAddress_, 0x001F);        // coarse X = 0
-        dataAddress_ ^= 0x0400;               //? switch horizontal nametable
-      } else {
-        ++dataAddress_;  // increment coarse X
+// Pattern row of the background tile at dataAddress_, decoded into buffer if
+// the mapper has no CHR window, and the upper two bits of its palette
+inline const Byte *PPU::fetchTile(Byte *buffer, Byte &palette) {
+  // fetch tile
+  Address addr = 0x2000 | (dataAddress_ & 0x0FFF);  // mask off fine y
+  Address tile = static_cast<Address>(read(addr));
+  // auto addr = 0x2000 + x / 8 + (y / 8) * (ScanlineVisibleDots / 8);
+
+  // fetch pattern
+  // Each pattern occupies 16 bytes, so multiply by 16
+  //
+  //    Character   Colors      Contents of Pattern Table
+  //    ...*....    00010000    00010000 $10  +-> 00000000 $00
+  //    ..O.O...    00202000    00000000 $00  |   00101000 $28
+  //    .#...#..    03000300    01000100 $44  |   01000100 $44
+  //    O.....O.    20000020    00000000 $00  |   10000010 $82
+  //    *******. -> 11111110 -> 11111110 $FE  |   00000000 $00
+  //    O.....O.    20000020    00000000 $00  |   10000010 $82
+  //    #.....#.    30000030    10000010 $82  |   10000010 $82
+  //    ........    00000000    00000000 $00  |   00000000 $00
+  //                                +---------+
+  //
+  // Add fine y /* dataAddress_  y % 8*/
+  // set whether the pattern is in the high or low page
+  addr = (tile << 4) | ((dataAddress_ >> 12) & 0x7);
+  if (HIGH_BG_PAGE()) addr |= 1 << 12;
+  const Byte *row = bus_.patternRow(addr);
+  if (!row) {
+    TileCache::DecodeRow(read(addr), read(addr + 8), buffer);
+    row = buffer;
+  }
+
+  //
+  //    Attribute Tables
+  //   +--------------+----------------+
+  //   |(0,0)  (1,0) 0|  (2,0)  (3,0) 1|
+  //   |(0,1)  (1,1)  |  (2,1)  (3,1)  |
+  //   +--------------+----------------+
+  //   |(0,2)  (1,2) 2|  (2,2)  (3,2) 3|
+  //   |(0,3)  (1,3)  |  (2,3)  (3,3)  |
+  //   +--------------+----------------+
+  //
+  // fetch attribute and calculate higher two bits of palette
+  // Attribute table start address is 0x23c0.
+  addr = 0x23C0 | (dataAddress_ & 0x0C00) | ((dataAddress_ >> 4) & 0x38) |
+         ((dataAddress_ >> 2) & 0x07);
+  auto attribute = read(addr);
+  int shift = ((dataAddress_ >> 4) & 4) | (dataAddress_ & 2);
+  // Extract the upper two bits for the color
+  palette = ((attribute >> shift) & 0x3) << 2;
+
+  return row;
+}
+
+// Increment/wrap coarse X
+inline void PPU::nextTile() {
+  if (TEST_BITS(dataAddress_, 0x001F)) {  // if coarse X == 31
+    CLR_BIT(dataAddress_, 0x001F);        // coarse X = 0
+    dataAddress_ ^= 0x0400;               //? switch horizontal nametable
+  } else {
+    ++dataAddress_;  // increment coarse X
+  }
+}
+
+// Color (0-3) of the sprite at pixel x of the current scanline
+inline Byte PPU::spritePixel(const Sprite &sprite, int x) {
+  int spr_x = x - sprite.x;
+  int spr_y = scanline_ - sprite.y - 1;
+  int length = LONG_SPRITE() ? 16 : 8;
+  int x_shift = 7 - (spr_x % 8), y_offset = spr_y % length;
+  Byte tile = sprite.tile, attribute = sprite.attr;
+
+  // If flipping horizontally
+  bool flip = TEST_BITS(attribute, 0x40);
+  if (flip) x_shift ^= 7;
+  // If flipping vertically
+  if (TEST_BITS(attribute, 0x80)) y_offset ^= (length - 1);
+
+  Address addr = 0;
+  if (LONG_SPRITE()) {
+    // 8x16 sprites.  bit-3 is one if it is the bottom tile of the sprite,
+    // multiply by two to get the next pattern
+    y_offset = (y_offset & 7) | ((y_offset & 8) << 1);
+    addr = (tile >> 1) * 32 + y_offset;
+    addr |= (tile & 1) << 12;  // Bank 0x1000 if bit-0 is high
+  } else {
+    addr = tile * 16 + y_offset;
+    if (HIGH_SPR_PAGE()) addr += 0x1000;
+  }
+
+  const Byte *row = bus_.patternRow(addr, flip);
+  return row ? row[spr_x] : READ_PIXEL(addr, x_shift);
+}
+
+// Nothing that affects the picture changes between two calls, see
+// SyncRender, so each tile is fetched once for the pixels it covers. Pattern
+// rows come decoded from the tile cache, unless the mapper has no CHR window
+void PPU::renderScanline(int end) {
+  if (skipFrame_) {
+    skipScanline(end);
+    return;
+  }
+
+  bool tileFetched = false;
+  const Byte *tileRow = nullptr;
+  Byte tileRowBuffer[8], tilePalette = 0;
+
+  for (; renderedX_ < end; ++renderedX_) {
+    Byte bgColor = 0, sprColor = 0;
+    bool bgOpaque = false, sprOpaque = true;
+    bool spriteForeground = false;
+
+    int x = renderedX_;
+    int y = scanline_;
+
+    if (SHOW_BACKGROUND()) {
+      auto x_fine = 7 - ((fineXScroll_ + x) & 7);
+      if (SHOW_EDGE_BACKGROUND() || x >= 8) {
+        if (!tileFetched) {
+          tileRow = fetchTile(tileRowBuffer, tilePalette);
+          tileFetched = true;
+        }
+        // Get the corresponding pixel determined by x_fine from the right
+        bgColor = tileRow[7 - x_fine];
+
+        // flag used to calculate final pixel with the sprite pixel
+        bgOpaque = bgColor;
+        bgColor |= tilePalette;
+      }
+      if (!x_fine) {
+        tileFetched = false;
+        nextTile();
       }
     }
-  }
 
-  if (SHOW_SPRITES() && (SHOW_EDGE_SPRITES() || x >= 8)) {
-    for (auto i : scanlineSprites_) {
-      const Sprite &sprPtr =
-          reinterpret_cast<const Sprite *>(spriteMemory_.data())[i];
-      int spr_x = x - sprPtr.x;
-      if (0 > spr_x || spr_x >= 8) continue;
-
-      int spr_y = y - sprPtr.y - 1;
-      int length = LONG_SPRITE() ? 16 : 8;
-      int x_shift = 7 - (spr_x % 8), y_offset = spr_y % length;
-      Byte tile = sprPtr.tile, attribute = sprPtr.attr;
-
-      // If flipping horizontally
-      if (TEST_BITS(attribute, 0x40)) x_shift ^= 7;
-      // If flipping vertically
-      if (TEST_BITS(attribute, 0x80)) y_offset ^= (length - 1);
-
-      Address addr = 0;
-      if (LONG_SPRITE()) {
-        // 8x16 sprites.  bit-3 is one if it is the bottom tile of the sprite,
-        // multiply by two to get the next pattern
-        y_offset = (y_offset & 7) | ((y_offset & 8) << 1);
-        addr = (tile >> 1) * 32 + y_offset;
-        addr |= (tile & 1) << 12;  // Bank 0x1000 if bit-0 is high
-      } else {
-        addr = tile * 16 + y_offset;
-        if (HIGH_SPR_PAGE()) addr += 0x1000;
+    if (SHOW_SPRITES() && (SHOW_EDGE_SPRITES() || x >= 8)) {
+      for (auto i : scanlineSprites_) {
+        const Sprite &sprPtr =
+            reinterpret_cast<const Sprite *>(spriteMemory_.data())[i];
+        int spr_x = x - sprPtr.x;
+        if (0 > spr_x || spr_x >= 8) continue;
+
+        sprColor = spritePixel(sprPtr, x);
+        if ((sprOpaque = sprColor) != 0) {
+          Byte attribute = sprPtr.attr;
+          // Select sprite palette
+          // bits 2-3
+          sprColor |= 0x10 | ((attribute & 0x3) << 2);
+          spriteForeground = !(attribute & 0x20);
+
+          // Sprite-0 hit detection
+          if (SHOW_BACKGROUND() && i == 0 && sprOpaque && bgOpaque) {
+#ifdef PPUSTATUS_IN_BYTE
+            SET_BIT(ppu_status_, 0x40);
+#else   // PPUSTATUS_IN_BYTE
+            sprZeroHit_ = true;
+#endif  // PPUSTATUS_IN_BYTE
+          }
+
+          break;  // Exit the loop now since we've found the highest priority
+                  // sprite
+        }
       }
+    }
+
+    Byte paletteAddr = bgColor;
+    if (sprOpaque && (!bgOpaque || spriteForeground)) {
+      paletteAddr = sprColor;
+    } else if (!bgOpaque && !sprOpaque) {
+      paletteAddr = 0;
+    }
+
+    pictureBuffer_[y * ScanlineVisibleDots + x] = bus_.readPalette(paletteAddr);
+  }
+}
 
-      sprColor = READ_PIXEL(addr, x_shift);
+// Same effects as renderScanline but no pixel: the scroll moves on a tile at a
+// time and only the pixels under sprite 0 are tested for a hit
+void PPU::skipScanline(int end) {
+  if (!SHOW_BACKGROUND()) {
+    // No scroll update, and sprite 0 cannot hit
+    renderedX_ = std::max(renderedX_, end);
+    return;
+  }
 
-      if ((sprOpaque = sprColor) != 0) {
-        // Select sprite palette
-        // bits 2-3
-        sprColor |= 0x10 | ((attribute & 0x3) << 2);
-        spriteForeground = !(attribute & 0x20);
+  // Pixels where sprite 0 may hit, if it is on the scanline
+  int hitBegin = end, hitEnd = end;
+#ifdef PPUSTATUS_IN_BYTE
+  bool hit = ppu_status_ & 0x40;
+#else   // PPUSTATUS_IN_BYTE
+  bool hit = sprZeroHit_;
+#endif  // PPUSTATUS_IN_BYTE
+  const Sprite &sprite0 =
+      reinterpret_cast<const Sprite *>(spriteMemory_.data())[0];
+  if (!hit && SHOW_SPRITES() && !scanlineSprites_.empty() &&
+      scanlineSprites_[0] == 0) {
+    hitBegin = sprite0.x;
+    hitEnd = std::min(end, sprite0.x + 8);
+    if (!SHOW_EDGE_BACKGROUND() || !SHOW_EDGE_SPRITES()) {
+      hitBegin = std::max(hitBegin, 8);
+    }
+  }
 
-        // Sprite-0 hit detection
-        if (SHOW_BACKGROUND() && i == 0 && sprOpaque && bgOpaque) {
+  Byte tileRowBuffer[8], tilePalette;
+  while (renderedX_ < end) {
+    int x_fine = 7 - ((fineXScroll_ + renderedX_) & 7);
+    int tileEnd = renderedX_ + x_fine + 1;
+
+    int begin = std::max(renderedX_, hitBegin);
+    int last = std::min({end, tileEnd, hitEnd});
+    if (begin < last) {
+      const Byte *tileRow = fetchTile(tileRowBuffer, tilePalette);
+      for (int x = begin; x < last; ++x) {
+        if (tileRow[(fineXScroll_ + x) & 7] && spritePixel(sprite0, x)) {
 #ifdef PPUSTATUS_IN_BYTE
           SET_BIT(ppu_status_, 0x40);
 #else   // PPUSTATUS_IN_BYTE
           sprZeroHit_ = true;
 #endif  // PPUSTATUS_IN_BYTE
+          hitBegin = hitEnd = end;
+          break;
         }
-
-        break;  // Exit the loop now since we've found the highest priority
-                // sprite
       }
     }
-  }
 
-  Byte paletteAddr = bgColor;
-  if (sprOpaque && (!bgOpaque || spriteForeground)) {
-    paletteAddr = sprColor;
-  } else if (!bgOpaque && !sprOpaque) {
-    paletteAddr = 0;
+    if (tileEnd > end) {
+      renderedX_ = end;
+    } else {
+      renderedX_ = tileEnd;
+      nextTile();
+    }
   }
-#undef READ_PIXEL
-
-  pictureBuffer_[x][y] = bus_.readPalette(paletteAddr);
 }
+#undef READ_PIXEL
 
 void PPU::doDMA(const Byte *page_ptr) {
   std::memcpy(spriteMemory_.data() + oamDataAddress_, page_ptr,
@@ -447,6 +604,7 @@ void PPU::setMask(Byte mask) {
   showEdgeSprites_ = mask & 0x4;
   showBackground_ = mask & 0x8;
   showSprites_ = mask & 0x10;
+  emphasis_ = mask & 0xe0;
 #endif  // PPUMASK_IN_BYTE
 }
 
@@ -541,12 +699,25 @@ void PPU::DebugDump() {
 }
 
 void PPU::Save(std::ostream &os) {
-  uint32_t lines = pictureBuffer_.size();
+  SyncRender();
+
+  // Saved column by column, the layout the picture used to have
+  uint32_t lines = ScanlineVisibleDots;
   Write(os, lines);
-  for (const auto &vec : pictureBuffer_) {
-    Write(os, vec);
+  Memory column(VisibleScanlines);
+  for (int x = 0; x < ScanlineVisibleDots; ++x) {
+    for (int y = 0; y < VisibleScanlines; ++y) {
+      column[y] = pictureBuffer_[y * ScanlineVisibleDots + x];
+    }
+    Write(os, column);
   }
 
+  SaveState(os);
+}
+
+void PPU::SaveState(std::ostream &os) {
+  SyncRender();
+
   Write(os, frameIndex_);
   Write(os, spriteMemory_);
   Write(os, scanlineSprites_);
@@ -605,11 +776,23 @@ void PPU::Save(std::ostream &os) {
 void PPU::Restore(std::istream &is) {
   uint32_t lines;
   Read(is, lines);
-  pictureBuffer_.resize(lines);
-  for (auto &vec : pictureBuffer_) {
-    Read(is, vec);
+  Memory column;
+  for (uint32_t x = 0; x < lines; ++x) {
+    Read(is, column);
+    if (x >= ScanlineVisibleDots || column.size() != VisibleScanlines) {
+      continue;
+    }
+    for (int y = 0; y < VisibleScanlines; ++y) {
+      pictureBuffer_[y * ScanlineVisibleDots + x] = column[y];
+    }
   }
 
+  RestoreState(is);
+
+  imageOutput();
+}
+
+void PPU::RestoreState(std::istream &is) {
   Read(is, frameIndex_);
   Read(is, spriteMemory_);
   Read(is, scanlineSprites_);
@@ -664,7 +847,34 @@ void PPU::Restore(std::istream &is) {
   bool sprZeroHit_;
 #endif  // PPUSTATUS_IN_BYTE
 
-  imageOutput();
+  restoreRenderedX();
+  updateSkipFrame();
+}
+
+void PPU::SnapshotTo(StateBuffer &buffer) {
+  SyncRender();
+
+  buffer.Put(static_cast<const PPUState &>(*this));
+  buffer.Put(spriteMemory_);
+  buffer.Put(scanlineSprites_);
+}
+
+void PPU::RestoreFrom(StateBuffer &buffer) {
+  buffer.Get(static_cast<PPUState &>(*this));
+  buffer.Get(spriteMemory_);
+  buffer.Get(scanlineSprites_);
+
+  restoreRenderedX();
+  updateSkipFrame();
+}
+
+void PPU::Hash(StateHash &hash) const { hash.Update(spriteMemory_); }
+
+void PPU::restoreRenderedX() {
+  // The state was taken with no pixel pending
+  renderedX_ = pipelineState_ == Render
+                   ? std::max(0, std::min(cycle_ - 1, ScanlineVisibleDots))
+                   : 0;
 }
 
 }  // namespace hn
@@ -15,15 +15,81 @@ constexpr int ScanlineEndCycle = 340;
 constexpr int VisibleScanlines = 240;
 constexpr int ScanlineVisibleDots = 256;
 
-class PPU : public Serialize {
+// Pipeline position and registers of the PPU, plain data for one-copy
+// snapshots
+struct PPUState {
+  enum State { PreRender, Render, PostRender, VerticalBlank } pipelineState_;
+  int cycle_;
+  int scanline_;
+  bool evenFrame_;
+  std::size_t frameIndex_;
+
+  // Registers
+  Address dataAddress_;
+  Address tempAddress_;
+  Address dataAddrIncrement_;
+
+  bool firstWrite_;
+  Byte fineXScroll_;
+  Byte dataBuffer_;
+
+  Byte oamDataAddress_;
+
+  // Setup flags and variables
+  // Control byte
+#ifdef PPUCONTROL_IN_BYTE
+  Byte ppu_control_;
+#else   // PPUCONTROL_IN_BYTE
+  bool longSprites_;
+  bool generateInterrupt_;
+
+  enum CharacterPage {
+    Low,
+    High,
+  } bgPage_,
+      sprPage_;
+#endif  // PPUCONTROL_IN_BYTE
+
+  // Mask byte
+#ifdef PPUMASK_IN_BYTE
+  Byte ppu_mask_;
+#else   // PPUMASK_IN_BYTE
+  bool greyscaleMode_;
+  bool showSprites_;
+  bool showBackground_;
+  bool showEdgeSprites_;
+  bool showEdgeBackground_;
+  Byte emphasis_;  // PPUMASK bits 5-7
+#endif  // PPUMASK_IN_BYTE
+
+  // Status byte
+#ifdef PPUSTATUS_IN_BYTE
+  Byte ppu_status_;
+#else   // PPUSTATUS_IN_BYTE
+  bool vblank_;
+  bool sprZeroHit_;
+#endif  // PPUSTATUS_IN_BYTE
+};
+
+class PPU : public Serialize, private PPUState {
  public:
   PPU(MainBus &mainBus, PictureBus &bus);
   void SetScreen(VirtualScreen *screen) { screen_ = screen; }
   void Step();
+  void Run(int dots);
   void Reset();
 
+  // Number of Step calls up to and including the next one that may raise
+  // NMI or clock the mapper on a scanline
+  int DotsToEvent() const;
+
   void doDMA(const Byte *page_ptr);
 
+  // Pixels are rendered lazily, in spans of the scanline, this renders the
+  // ones still pending. Must be called before anything that may change how
+  // they look: register accesses and mapper writes
+  void SyncRender();
+
   // Callbacks mapped to CPU address space
   // Addresses written to by the program
   void control(Byte ctrl);
@@ -43,9 +109,26 @@ class PPU : public Serialize {
   PictureBus &bus() const { return bus_; }
 
   std::size_t frameIndex() const { return frameIndex_; }
+  // Row-major palette indices, up to date after SyncRender
+  const Memory &picture() const { return pictureBuffer_; }
+
+  // Skips the picture of `skip` frames out of every `period`, keeping what
+  // the CPU sees: status flags, sprite-0 hit, NMI and mapper scanline clocks.
+  // A period of 0 renders every frame
+  void SetFrameSkip(int skip, int period);
+  // Skips the picture of the next frame as well, for frames never shown
+  void SetPictureHidden(bool hidden) { pictureHidden_ = hidden; }
+  // Draws the frames before a multiple of the interval whatever the frame
+  // skip, for pictures that are checked. 0 for none
+  void SetDrawInterval(int interval) { drawInterval_ = interval; }
 
   virtual void Save(std::ostream &os) override;
   virtual void Restore(std::istream &is) override;
+  // Snapshots leave the picture out
+  virtual void SnapshotTo(StateBuffer &buffer) override;
+  virtual void RestoreFrom(StateBuffer &buffer) override;
+  // Sprite memory, the buses are hashed on their own
+  void Hash(StateHash &hash) const;
 
  protected:
   void postRender();
@@ -53,7 +136,9 @@ class PPU : public Serialize {
   void render();
   void vBlank();
 
-  void renderInScanline();
+  // Renders the current scanline up to, but excluding, pixel end
+  void renderScanline(int end);
+  void skipScanline(int end);
   void imageOutput();
 
  private:
@@ -63,21 +148,13 @@ class PPU : public Serialize {
   PictureBus &bus_;
   VirtualScreen *screen_;
 
-  enum State { PreRender, Render, PostRender, VerticalBlank } pipelineState_;
-  int cycle_;
-  int scanline_;
-  bool evenFrame_;
-
-  // Registers
-  Address dataAddress_;
-  Address tempAddress_;
-  Address dataAddrIncrement_;
-
-  bool firstWrite_;
-  Byte fineXScroll_;
-  Byte dataBuffer_;
+  int renderedX_;  // pixels of the current scanline already rendered
 
-  Byte oamDataAddress_;
+  int frameSkip_;
+  int frameSkipPeriod_;
+  bool pictureHidden_;
+  int drawInterval_;
+  bool skipFrame_;  // no picture for the current frame
 
   typedef struct {
     Byte y;
@@ -86,44 +163,19 @@ class PPU : public Serialize {
     Byte x;
   } Sprite;
 
-  // Setup flags and variables
-  // Control byte
-#ifdef PPUCONTROL_IN_BYTE
-  Byte ppu_control_;
-#else   // PPUCONTROL_IN_BYTE
-  bool longSprites_;
-  bool generateInterrupt_;
+  const Byte *fetchTile(Byte *buffer, Byte &palette);
+  void nextTile();
+  Byte spritePixel(const Sprite &sprite, int x);
+  // Everything but the picture
+  void SaveState(std::ostream &os);
+  void RestoreState(std::istream &is);
+  void restoreRenderedX();
+  // Picture or not for the current frame
+  void updateSkipFrame();
 
-  enum CharacterPage {
-    Low,
-    High,
-  } bgPage_,
-      sprPage_;
-#endif  // PPUCONTROL_IN_BYTE
-
-  // Mask byte
-#ifdef PPUMASK_IN_BYTE
-  Byte ppu_mask_;
-#else   // PPUMASK_IN_BYTE
-  bool greyscaleMode_;
-  bool showSprites_;
-  bool showBackground_;
-  bool showEdgeSprites_;
-  bool showEdgeBackground_;
-#endif  // PPUMASK_IN_BYTE
-
-  // Status byte
-#ifdef PPUSTATUS_IN_BYTE
-  Byte ppu_status_;
-#else   // PPUSTATUS_IN_BYTE
-  bool vblank_;
-  bool sprZeroHit_;
-#endif  // PPUSTATUS_IN_BYTE
-
-  std::size_t frameIndex_;
   Memory spriteMemory_;
   Memory scanlineSprites_;
-  Image pictureBuffer_;
+  Memory pictureBuffer_;  // row-major, ScanlineVisibleDots per line
 };
 
 }  // namespace hn
@@ -0,0 +1,236 @@
+#include "PaletteConverter.h"
+
+#include "PaletteColors.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HN_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace hn {
+
+// Each emphasis bit darkens the other two channels
+constexpr float kEmphasisAttenuation = 0.816328f;
+
+namespace {
+
+using ConvertFunc = void (*)(const Byte (*planes)[64], const uint32_t *pixels,
+                             int bytes, const Color *indices,
+                             std::size_t count, Byte index_mask, Byte *out);
+
+template <int kBytes>
+void ConvertPixels(const uint32_t *pixels, const Color *indices,
+                   std::size_t count, Byte index_mask, Byte *out) {
+  for (std::size_t i = 0; i < count; ++i, out += kBytes) {
+    std::memcpy(out, &pixels[indices[i] & index_mask], kBytes);
+  }
+}
+
+void ConvertScalar(const Byte (* /*planes*/)[64], const uint32_t *pixels,
+                   int bytes, const Color *indices, std::size_t count,
+                   Byte index_mask, Byte *out) {
+  if (bytes == 2) {
+    ConvertPixels<2>(pixels, indices, count, index_mask, out);
+  } else {
+    ConvertPixels<4>(pixels, indices, count, index_mask, out);
+  }
+}
+
+#ifdef HN_X86_SIMD
+// The alpha of the 4-byte formats is the same for every color, it needs no
+// lookup then
+bool IsConstant(const Byte *plane) {
+  return std::all_of(plane, plane + 64, [=](Byte b) { return b == plane[0]; });
+}
+
+// A 64-entry byte table is four 16-entry PSHUFB tables. Bits 4 and 5 of the
+// index pick one of them, moved to the top bit of the byte for PBLENDVB
+__attribute__((target("sse4.1"))) inline __m128i Lookup(const __m128i *table,
+                                                        __m128i index) {
+  __m128i low = _mm_blendv_epi8(_mm_shuffle_epi8(table[0], index),
+                                _mm_shuffle_epi8(table[1], index),
+                                _mm_slli_epi16(index, 3));
+  __m128i high = _mm_blendv_epi8(_mm_shuffle_epi8(table[2], index),
+                                 _mm_shuffle_epi8(table[3], index),
+                                 _mm_slli_epi16(index, 3));
+  return _mm_blendv_epi8(low, high, _mm_slli_epi16(index, 2));
+}
+
+__attribute__((target("sse4.1"))) void ConvertSSE41(
+    const Byte (*planes)[64], const uint32_t *pixels, int bytes,
+    const Color *indices, std::size_t count, Byte index_mask, Byte *out) {
+  __m128i tables[4][4];
+  for (int p = 0; p < bytes; ++p) {
+    for (int t = 0; t < 4; ++t) {
+      tables[p][t] = _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(planes[p] + t * 16));
+    }
+  }
+  const __m128i mask = _mm_set1_epi8(static_cast<char>(index_mask & 0x3f));
+  const __m128i alpha = _mm_set1_epi8(static_cast<char>(planes[3][0]));
+  const bool opaque = IsConstant(planes[3]);
+
+  std::size_t i = 0;
+  for (; i + 16 <= count; i += 16, out += 16 * bytes) {
+    __m128i index = _mm_and_si128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(indices + i)), mask);
+    __m128i *dst = reinterpret_cast<__m128i *>(out);
+
+    __m128i p0 = Lookup(tables[0], index);
+    __m128i p1 = Lookup(tables[1], index);
+    __m128i p01lo = _mm_unpacklo_epi8(p0, p1);
+    __m128i p01hi = _mm_unpackhi_epi8(p0, p1);
+    if (bytes == 2) {
+      _mm_storeu_si128(dst, p01lo);
+      _mm_storeu_si128(dst + 1, p01hi);
+      continue;
+    }
+
+    __m128i p2 = Lookup(tables[2], index);
+    __m128i p3 = opaque ? alpha : Lookup(tables[3], index);
+    __m128i p23lo = _mm_unpacklo_epi8(p2, p3);
+    __m128i p23hi = _mm_unpackhi_epi8(p2, p3);
+    _mm_storeu_si128(dst, _mm_unpacklo_epi16(p01lo, p23lo));
+    _mm_storeu_si128(dst + 1, _mm_unpackhi_epi16(p01lo, p23lo));
+    _mm_storeu_si128(dst + 2, _mm_unpacklo_epi16(p01hi, p23hi));
+    _mm_storeu_si128(dst + 3, _mm_unpackhi_epi16(p01hi, p23hi));
+  }
+
+  ConvertScalar(planes, pixels, bytes, indices + i, count - i, index_mask,
+                out);
+}
+
+// Same as the SSE4.1 one on 32 pixels. The unpacks work within each 128-bit
+// lane, so the lanes are put back in order when storing
+__attribute__((target("avx2"))) inline __m256i Lookup(const __m256i *table,
+                                                      __m256i index) {
+  __m256i low = _mm256_blendv_epi8(_mm256_shuffle_epi8(table[0], index),
+                                   _mm256_shuffle_epi8(table[1], index),
+                                   _mm256_slli_epi16(index, 3));
+  __m256i high = _mm256_blendv_epi8(_mm256_shuffle_epi8(table[2], index),
+                                    _mm256_shuffle_epi8(table[3], index),
+                                    _mm256_slli_epi16(index, 3));
+  return _mm256_blendv_epi8(low, high, _mm256_slli_epi16(index, 2));
+}
+
+__attribute__((target("avx2"))) void ConvertAVX2(
+    const Byte (*planes)[64], const uint32_t *pixels, int bytes,
+    const Color *indices, std::size_t count, Byte index_mask, Byte *out) {
+  __m256i tables[4][4];
+  for (int p = 0; p < bytes; ++p) {
+    for (int t = 0; t < 4; ++t) {
+      tables[p][t] = _mm256_broadcastsi128_si256(_mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(planes[p] + t * 16)));
+    }
+  }
+  const __m256i mask = _mm256_set1_epi8(static_cast<char>(index_mask & 0x3f));
+  const __m256i alpha = _mm256_set1_epi8(static_cast<char>(planes[3][0]));
+  const bool opaque = IsConstant(planes[3]);
+
+  std::size_t i = 0;
+  for (; i + 32 <= count; i += 32, out += 32 * bytes) {
+    __m256i index = _mm256_and_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(indices + i)),
+        mask);
+    __m256i *dst = reinterpret_cast<__m256i *>(out);
+
+    __m256i p0 = Lookup(tables[0], index);
+    __m256i p1 = Lookup(tables[1], index);
+    __m256i p01lo = _mm256_unpacklo_epi8(p0, p1);
+    __m256i p01hi = _mm256_unpackhi_epi8(p0, p1);
+    if (bytes == 2) {
+      _mm256_storeu_si256(dst, _mm256_permute2x128_si256(p01lo, p01hi, 0x20));
+      _mm256_storeu_si256(dst + 1,
+                          _mm256_permute2x128_si256(p01lo, p01hi, 0x31));
+      continue;
+    }
+
+    __m256i p2 = Lookup(tables[2], index);
+    __m256i p3 = opaque ? alpha : Lookup(tables[3], index);
+    __m256i p23lo = _mm256_unpacklo_epi8(p2, p3);
+    __m256i p23hi = _mm256_unpackhi_epi8(p2, p3);
+    // Pixels 0-3 and 16-19, 4-7 and 20-23, 8-11 and 24-27, 12-15 and 28-31
+    __m256i q0 = _mm256_unpacklo_epi16(p01lo, p23lo);
+    __m256i q1 = _mm256_unpackhi_epi16(p01lo, p23lo);
+    __m256i q2 = _mm256_unpacklo_epi16(p01hi, p23hi);
+    __m256i q3 = _mm256_unpackhi_epi16(p01hi, p23hi);
+    _mm256_storeu_si256(dst, _mm256_permute2x128_si256(q0, q1, 0x20));
+    _mm256_storeu_si256(dst + 1, _mm256_permute2x128_si256(q2, q3, 0x20));
+    _mm256_storeu_si256(dst + 2, _mm256_permute2x128_si256(q0, q1, 0x31));
+    _mm256_storeu_si256(dst + 3, _mm256_permute2x128_si256(q2, q3, 0x31));
+  }
+
+  ConvertScalar(planes, pixels, bytes, indices + i, count - i, index_mask,
+                out);
+}
+#endif  // HN_X86_SIMD
+
+PaletteConverter::Isa SupportedIsa() {
+#ifdef HN_X86_SIMD
+  if (__builtin_cpu_supports("avx2")) return PaletteConverter::AVX2;
+  if (__builtin_cpu_supports("sse4.1")) return PaletteConverter::SSE41;
+#endif  // HN_X86_SIMD
+  return PaletteConverter::SCALAR;
+}
+
+}  // namespace
+
+PaletteConverter::PaletteConverter(PixelFormat format, Isa isa)
+    : format_(format), isa_(std::min(isa, SupportedIsa())) {
+  for (int e = 0; e < kEmphasisSets; ++e) {
+    for (int c = 0; c < kColors; ++c) {
+      // colors[] is 0xRRGGBBAA. Emphasis bits are red, green, blue from low
+      float rgb[3] = {static_cast<float>(colors[c] >> 24),
+                      static_cast<float>((colors[c] >> 16) & 0xff),
+                      static_cast<float>((colors[c] >> 8) & 0xff)};
+      for (int bit = 0; bit < 3; ++bit) {
+        if (!(e & (1 << bit))) continue;
+        for (int channel = 0; channel < 3; ++channel) {
+          if (channel != bit) rgb[channel] *= kEmphasisAttenuation;
+        }
+      }
+      Byte r = static_cast<Byte>(rgb[0] + 0.5f);
+      Byte g = static_cast<Byte>(rgb[1] + 0.5f);
+      Byte b = static_cast<Byte>(rgb[2] + 0.5f);
+      Byte a = colors[c] & 0xff;
+
+      Byte pixel[4] = {};
+      switch (format_) {
+        case RGBA8888:
+          pixel[0] = r, pixel[1] = g, pixel[2] = b, pixel[3] = a;
+          break;
+        case BGRA8888:
+          pixel[0] = b, pixel[1] = g, pixel[2] = r, pixel[3] = a;
+          break;
+        case RGB565: {
+          Word rgb565 = (r >> 3) << 11 | (g >> 2) << 5 | b >> 3;
+          pixel[0] = rgb565 & 0xff, pixel[1] = rgb565 >> 8;
+          break;
+        }
+      }
+      for (int p = 0; p < 4; ++p) {
+        planes_[e][p][c] = pixel[p];
+      }
+      std::memcpy(&pixels_[e][c], pixel, sizeof(pixel));
+    }
+  }
+}
+
+void PaletteConverter::Convert(const Color *indices, std::size_t count,
+                               Byte mask, void *out) const {
+  // Greyscale keeps the grey column of the palette, the top two index bits
+  Byte index_mask = (mask & 0x1) ? 0x30 : 0x3f;
+  ConvertFunc convert = ConvertScalar;
+#ifdef HN_X86_SIMD
+  if (isa_ == AVX2) {
+    convert = ConvertAVX2;
+  } else if (isa_ == SSE41) {
+    convert = ConvertSSE41;
+  }
+#endif  // HN_X86_SIMD
+
+  convert(planes_[mask >> 5], pixels_[mask >> 5], bytesPerPixel(), indices,
+          count, index_mask, static_cast<Byte *>(out));
+}
+
+}  // namespace hn
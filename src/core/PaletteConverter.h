@@ -0,0 +1,41 @@
+#pragma once
+
+#include "common.h"
+
+namespace hn {
+
+// Turns frames of palette indices into pixels for the screens and captures.
+// Colors come from a 512-entry palette, the 64 NES colors under each of the
+// 8 emphasis settings of PPUMASK.
+class PaletteConverter {
+ public:
+  // Byte order in memory
+  enum PixelFormat { RGBA8888, BGRA8888, RGB565 };
+  // Code paths, the best the CPU supports is used unless asked for less
+  enum Isa { SCALAR, SSE41, AVX2 };
+
+  explicit PaletteConverter(PixelFormat format, Isa isa = AVX2);
+
+  // Converts count indices to pixels at out, bytesPerPixel() each. mask is
+  // PPUMASK as it was for the frame: greyscale and the emphasis bits apply
+  void Convert(const Color *indices, std::size_t count, Byte mask,
+               void *out) const;
+
+  PixelFormat format() const { return format_; }
+  Isa isa() const { return isa_; }
+  int bytesPerPixel() const { return format_ == RGB565 ? 2 : 4; }
+
+ private:
+  static constexpr int kEmphasisSets = 8;
+  static constexpr int kColors = 64;
+
+  PixelFormat format_;
+  Isa isa_;
+  // Pixel bytes of each palette entry, as byte planes for the SIMD lookups:
+  // byte p of color c under emphasis e is planes_[e][p][c]
+  Byte planes_[kEmphasisSets][4][kColors];
+  // The same bytes, packed in memory order for the scalar path
+  uint32_t pixels_[kEmphasisSets][kColors];
+};
+
+}  // namespace hn
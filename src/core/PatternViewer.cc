@@ -105,10 +105,12 @@ void PatternViewer::UpdateImage() {
   for (size_t cell = pageNum_ * kTilesInOnePage, line = 0;
        cell < cellSize && line < kShowTilesOneLine; cell++) {
     size_t addr = cell << 4, tileX = (cell & 0x1f) << 3, lineX = line << 3;
-    for (size_t x = 0, mask = 0x80; x < 8; x++, mask >>= 1) {
+    // Cells of a page go through the 8 bank slots as the PPU would see them
+    const Byte* pixels = tiles_.Tile((addr >> 10) & 0x7, &vrom[addr & ~0x3ff],
+                                     cell % kTilesInBank);
+    for (size_t x = 0; x < 8; x++) {
       for (size_t y = 0; y < 8; y++) {
-        int c = (!!(vrom[addr + y] & mask)) |
-                ((!!(vrom[addr + y + 8] & mask)) << 1);
+        int c = pixels[(y << 3) + x];
         if (c) c = (c + colorShift_) % 3 + 1;
         pictureBuffer_[x + tileX][y + lineX] = maskIndex[c];
       }
@@ -122,6 +124,7 @@ void PatternViewer::UpdateImage() {
 
 void PatternViewer::setCartridge(Cartridge& cartridge) {
   vRom_ = &cartridge.getVROM();
+  tiles_.Invalidate();
 
   char buff[1024];
   sprintf(buff, "There are %lu pages in cartridge.", pageCount());
@@ -129,7 +132,10 @@ void PatternViewer::setCartridge(Cartridge& cartridge) {
   emulatorScreen_.setTip(buff);
 }
 
-void PatternViewer::setRom(const std::vector<Byte>* vRom) { vRom_ = vRom; }
+void PatternViewer::setRom(const std::vector<Byte>* vRom) {
+  vRom_ = vRom;
+  tiles_.Invalidate();
+}
 
 inline size_t PatternViewer::pageCount() const {
   return vRom_ ? vRom_->size() / kVROMPageSize : 0;
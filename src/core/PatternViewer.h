@@ -3,6 +3,7 @@
 #include <chrono>
 
 #include "Cartridge.h"
+#include "TileCache.h"
 #include "devices/SfmlScreen.h"
 
 namespace hn {
@@ -37,6 +38,7 @@ class PatternViewer {
   int colorShift_;
   size_t pageNum_;
   std::vector<std::vector<Color>> pictureBuffer_;
+  TileCache tiles_;
 };
 
 }  // namespace hn
@@ -12,6 +12,19 @@ class VirtualScreen {
                       Color color) = 0;
 
   virtual void setPixel(std::size_t x, std::size_t y, Color color) = 0;
+  // Sets a whole frame at once, pixels are contiguous and row-major. mask is
+  // PPUMASK for the greyscale and emphasis bits, see PaletteConverter.
+  // Screens able to convert it in bulk should override this, the pixels
+  // set one by one lose the emphasis
+  virtual void setFrame(const Color *frame, std::size_t width,
+                        std::size_t height, Byte mask) {
+    Byte index_mask = (mask & 0x1) ? 0x30 : 0x3f;
+    for (std::size_t y = 0; y < height; ++y) {
+      for (std::size_t x = 0; x < width; ++x) {
+        setPixel(x, y, frame[y * width + x] & index_mask);
+      }
+    }
+  }
   virtual void resize(float pixel_size) = 0;
 
   virtual void setTip(const std::string &msg) = 0;
@@ -20,15 +33,25 @@ class VirtualScreen {
 // VirtulaSpeaker interface
 class VirtualSpeaker {
  public:
-  VirtualSpeaker(unsigned int channel = 1, unsigned int sample_rate = 44100) {}
+  VirtualSpeaker(unsigned int channel = 1, unsigned int sample_rate = 44100)
+      : sample_rate_(sample_rate) {}
   virtual ~VirtualSpeaker() = default;
 
   virtual void PushSample(std::int16_t *data, size_t count) = 0;
   virtual void Play() = 0;
   virtual void Stop() = 0;
+
+  // Samples pushed but not played yet, for speakers that buffer them
+  virtual size_t queuedSamples() const { return 0; }
+
+  unsigned int sampleRate() const { return sample_rate_; }
+
+ private:
+  unsigned int sample_rate_;
 };
 
-// VirtulaJoypad interface
+// VirtulaJoypad interface. The emulator takes the buttons once a frame and
+// plays the shift register of the NES controller itself
 class VirtualJoypad {
  public:
   enum Buttons {
@@ -43,8 +66,10 @@ class VirtualJoypad {
     TotalButtons,
   };
 
-  virtual void strobe(Byte b) = 0;
-  virtual Byte read() = 0;
+  virtual ~VirtualJoypad() = default;
+
+  // Buttons held down, bit n for button n
+  virtual Byte buttons() const = 0;
   virtual void setKeyBindings(const class JoypadInputConfig &keys) = 0;
 };
 
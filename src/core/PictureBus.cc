@@ -52,8 +52,7 @@ namespace hn {
 PictureBus::PictureBus()
     : RAM_(0x800), palette_(0x20), mapper_(nullptr), NameTable_(4) {}
 
-Byte PictureBus::read(Address addr) {
-  addr &= 0x3fff;
+Byte PictureBus::readUnmapped(Address addr) {
   if (addr < 0x2000) {
     return mapper_->readCHR(addr);
   } else if (addr < 0x3f00) {
@@ -83,6 +82,11 @@ void PictureBus::write(Address addr, Byte value) {
   addr &= 0x3fff;
   if (addr < 0x2000) {
     mapper_->writeCHR(addr, value);
+
+    const Byte* bank = mapper_->chrWindow(addr);
+    if (bank) {
+      tiles_.Invalidate(bank + (addr & 0x3ff));
+    }
   } else if (addr < 0x3f00) {
     // Name tables upto 0x3000, then mirrored upto 3eff
     auto index = addr & 0x3ff;
@@ -171,6 +175,27 @@ void PictureBus::Restore(std::istream& is) {
   Read(is, RAM_);
   Read(is, NameTable_);
   Read(is, palette_);
+
+  tiles_.Invalidate();
+}
+
+void PictureBus::SnapshotTo(StateBuffer& buffer) {
+  buffer.Put(RAM_);
+  buffer.Put(NameTable_);
+  buffer.Put(palette_);
+}
+void PictureBus::RestoreFrom(StateBuffer& buffer) {
+  buffer.Get(RAM_);
+  buffer.Get(NameTable_);
+  buffer.Get(palette_);
+
+  tiles_.Invalidate();
+}
+
+void PictureBus::Hash(StateHash& hash) const {
+  hash.Update(RAM_);
+  hash.Update(NameTable_.data(), NameTable_.size() * sizeof(size_t));
+  hash.Update(palette_);
 }
 
 }  // namespace hn
@@ -3,14 +3,30 @@
 #include <vector>
 #include "../mapper/Mapper.h"
 #include "Cartridge.h"
+#include "StateHash.h"
+#include "TileCache.h"
 
 namespace hn {
 class PictureBus : public Serialize {
  public:
   PictureBus();
-  Byte read(Address addr);
+  // Pattern tables are read through the mapper CHR windows when it has them
+  Byte read(Address addr) {
+    addr &= 0x3fff;
+    const Byte* bank = addr < 0x2000 ? mapper_->chrWindow(addr) : nullptr;
+    return bank ? bank[addr & 0x3ff] : readUnmapped(addr);
+  }
   void write(Address addr, Byte value);
 
+  // Decoded pattern row at addr, nullptr when the mapper does not map a CHR
+  // window there
+  const Byte* patternRow(Address addr, bool flip = false) {
+    const Byte* bank = mapper_->chrWindow(addr);
+    return bank ? tiles_.Row(bank, addr, flip) : nullptr;
+  }
+  // Called when CHR memory changed behind the bus
+  void invalidateTiles() { tiles_.Invalidate(); }
+
   bool setMapper(Mapper* mapper);
   Byte readPalette(Byte paletteAddr);
 
@@ -18,14 +34,22 @@ class PictureBus : public Serialize {
 
   virtual void Save(std::ostream& os) override;
   virtual void Restore(std::istream& is) override;
+  virtual void SnapshotTo(StateBuffer& buffer) override;
+  virtual void RestoreFrom(StateBuffer& buffer) override;
+  // Nametables and palette
+  void Hash(StateHash& hash) const;
 
  private:
+  Byte readUnmapped(Address addr);
+
   Memory RAM_;
   std::vector<size_t> NameTable_;  // indices where they start in RAM vector
 
   std::vector<Byte> palette_;
 
   Mapper* mapper_;
+
+  TileCache tiles_;
 };
 
 }  // namespace hn
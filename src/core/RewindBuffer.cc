@@ -0,0 +1,63 @@
+#include "RewindBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "StateDelta.h"
+#include "glog/logging.h"
+
+namespace hn {
+
+RewindBuffer::RewindBuffer(std::size_t arena_size)
+    : arena_(arena_size), head_(0) {}
+
+void RewindBuffer::Push(const StateBuffer &state) {
+  EncodeDelta(state.data(), state.size(), last_, diff_, encoded_);
+  std::size_t size = encoded_.size();
+  if (size > arena_.size()) {
+    LOG(ERROR) << "State of " << size << " bytes too large to rewind";
+    Clear();
+    return;
+  }
+
+  std::size_t pos = head_;
+  if (pos + size > arena_.size()) {
+    // Wrap around, the records left at the end are the oldest
+    while (!records_.empty() && records_.front().offset >= pos) {
+      records_.pop_front();
+    }
+    pos = 0;
+  }
+  while (!records_.empty() && records_.front().offset >= pos &&
+         records_.front().offset < pos + size) {
+    records_.pop_front();
+  }
+
+  std::memcpy(&arena_[pos], encoded_.data(), size);
+  records_.push_back({pos, size, last_.size()});
+  head_ = pos + size;
+  last_.assign(state.data(), state.data() + state.size());
+}
+
+bool RewindBuffer::Pop(StateBuffer &state) {
+  if (records_.empty()) return false;
+
+  const Record &record = records_.back();
+  state.Assign(last_.data(), last_.size());
+
+  last_.resize(std::max(last_.size(), record.length), 0);
+  DecodeDelta(&arena_[record.offset], record.size, last_);
+  last_.resize(record.length);
+
+  head_ = record.offset;
+  records_.pop_back();
+  return true;
+}
+
+void RewindBuffer::Clear() {
+  records_.clear();
+  head_ = 0;
+  last_.clear();
+}
+
+}  // namespace hn
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "common.h"
+
+namespace hn {
+
+// Emulator states kept for rewinding, in a fixed arena. Each state is stored
+// as its XOR against the state before it, run-length encoded, and only the
+// newest one is kept whole: stepping back decodes one record at a time, and
+// the oldest records are dropped when the arena is full.
+class RewindBuffer {
+ public:
+  explicit RewindBuffer(std::size_t arena_size);
+
+  void Push(const StateBuffer &state);
+  // Takes out the newest state, false if there is none left
+  bool Pop(StateBuffer &state);
+  void Clear();
+
+  std::size_t size() const { return records_.size(); }
+
+ private:
+  struct Record {
+    std::size_t offset;  // in the arena
+    std::size_t size;
+    std::size_t length;  // of the state before
+  };
+
+  std::vector<Byte> arena_;
+  std::deque<Record> records_;
+  std::size_t head_;  // where the next record goes
+
+  Memory last_;  // newest state
+  std::vector<Byte> diff_;
+  std::vector<Byte> encoded_;
+};
+
+}  // namespace hn
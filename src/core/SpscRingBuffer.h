@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace hn {
+
+// Lock-free ring buffer for exactly one producer thread and one consumer
+// thread. The capacity is rounded up to a power of two.
+template <typename T>
+class SpscRingBuffer {
+ public:
+  explicit SpscRingBuffer(std::size_t capacity) : head_(0), tail_(0) {
+    std::size_t size = 1;
+    while (size < capacity) size <<= 1;
+    buffer_.resize(size);
+    mask_ = size - 1;
+  }
+
+  // Producer side. Returns how many items fit, the others are dropped
+  std::size_t Push(const T *data, std::size_t count) {
+    std::size_t tail = tail_.load(std::memory_order_relaxed);
+    std::size_t head = head_.load(std::memory_order_acquire);
+    std::size_t room = buffer_.size() - (tail - head);
+    if (count > room) count = room;
+
+    for (std::size_t i = 0; i < count; ++i) {
+      buffer_[(tail + i) & mask_] = data[i];
+    }
+    tail_.store(tail + count, std::memory_order_release);
+
+    return count;
+  }
+
+  // Consumer side. Returns how many items were available
+  std::size_t Pop(T *data, std::size_t count) {
+    std::size_t head = head_.load(std::memory_order_relaxed);
+    std::size_t tail = tail_.load(std::memory_order_acquire);
+    if (count > tail - head) count = tail - head;
+
+    for (std::size_t i = 0; i < count; ++i) {
+      data[i] = buffer_[(head + i) & mask_];
+    }
+    head_.store(head + count, std::memory_order_release);
+
+    return count;
+  }
+
+  // Fill level, exact only on either side of the buffer
+  std::size_t size() const {
+    return tail_.load(std::memory_order_acquire) -
+           head_.load(std::memory_order_acquire);
+  }
+  std::size_t capacity() const { return buffer_.size(); }
+
+ private:
+  std::vector<T> buffer_;
+  std::size_t mask_;
+
+  // Monotonic positions, head_ written by the consumer, tail_ by the producer
+  std::atomic<std::size_t> head_;
+  std::atomic<std::size_t> tail_;
+};
+
+}  // namespace hn
@@ -0,0 +1,80 @@
+#include "StateDelta.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace hn {
+
+static Byte *PutVarint(Byte *out, std::size_t value) {
+  while (value >= 0x80) {
+    *out++ = static_cast<Byte>(value | 0x80);
+    value >>= 7;
+  }
+  *out++ = static_cast<Byte>(value);
+  return out;
+}
+
+static const Byte *GetVarint(const Byte *in, std::size_t &value) {
+  value = 0;
+  for (int shift = 0;; shift += 7) {
+    value |= std::size_t(*in & 0x7f) << shift;
+    if (!(*in++ & 0x80)) break;
+  }
+  return in;
+}
+
+// A literal run goes on over single zero bytes
+static std::size_t Encode(const Byte *diff, std::size_t length, Byte *out) {
+  Byte *begin = out;
+  std::size_t i = 0;
+  while (i < length) {
+    std::size_t zeros = i;
+    while (i < length && !diff[i]) ++i;
+    if (i == length) break;
+    zeros = i - zeros;
+
+    std::size_t literal = i;
+    while (i < length && (diff[i] || (i + 1 < length && diff[i + 1]))) ++i;
+    literal = i - literal;
+
+    out = PutVarint(out, zeros);
+    out = PutVarint(out, literal);
+    std::memcpy(out, diff + i - literal, literal);
+    out += literal;
+  }
+
+  return out - begin;
+}
+
+void EncodeDelta(const Byte *state, std::size_t size, const Memory &before,
+                 Memory &diff, Memory &out) {
+  std::size_t length = std::max(size, before.size());
+  diff.assign(length, 0);
+  std::memcpy(diff.data(), state, size);
+  for (std::size_t i = 0; i < before.size(); ++i) {
+    diff[i] ^= before[i];
+  }
+
+  // Worst case, a literal of one byte between every two zeros
+  out.resize(length + length / 3 * 2 + 32);
+  out.resize(Encode(diff.data(), length, out.data()));
+}
+
+void DecodeDelta(const Byte *in, std::size_t size, Memory &state) {
+  const Byte *end = in + size;
+  std::size_t pos = 0;
+  while (in < end) {
+    std::size_t zeros, literal;
+    in = GetVarint(in, zeros);
+    in = GetVarint(in, literal);
+
+    pos += zeros;
+    for (std::size_t i = 0; i < literal; ++i) {
+      state[pos + i] ^= in[i];
+    }
+    pos += literal;
+    in += literal;
+  }
+}
+
+}  // namespace hn
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "common.h"
+
+namespace hn {
+
+// States stored as their XOR against the state before, the shorter one padded
+// with zeros. The XOR is a sequence of runs: zero bytes to skip, then literal
+// bytes, so the parts that did not change take almost no room.
+
+// Encodes the XOR of the state against the one before into out, using diff
+// as scratch
+void EncodeDelta(const Byte *state, std::size_t size, const Memory &before,
+                 Memory &diff, Memory &out);
+// XORs the runs into the state, which has to be as long as the longer of the
+// two states
+void DecodeDelta(const Byte *in, std::size_t size, Memory &state);
+
+}  // namespace hn
@@ -0,0 +1,120 @@
+#include "StateHash.h"
+
+namespace hn {
+
+// Reference:
+//
+//  https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+//
+static constexpr uint64_t kPrime1 = 0x9e3779b185ebca87ULL;
+static constexpr uint64_t kPrime2 = 0xc2b2ae3d27d4eb4fULL;
+static constexpr uint64_t kPrime3 = 0x165667b19e3779f9ULL;
+static constexpr uint64_t kPrime4 = 0x85ebca77c2b2ae63ULL;
+static constexpr uint64_t kPrime5 = 0x27d4eb2f165667c5ULL;
+
+static inline uint64_t Rotl(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+// Little-endian, as the NES and every host this runs on
+static inline uint64_t Load64(const Byte *p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint32_t Load32(const Byte *p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static inline uint64_t Round(uint64_t acc, uint64_t input) {
+  acc += input * kPrime2;
+  return Rotl(acc, 31) * kPrime1;
+}
+
+static inline uint64_t MergeRound(uint64_t hash, uint64_t acc) {
+  hash ^= Round(0, acc);
+  return hash * kPrime1 + kPrime4;
+}
+
+static inline void Stripe(uint64_t *acc, const Byte *p) {
+  acc[0] = Round(acc[0], Load64(p));
+  acc[1] = Round(acc[1], Load64(p + 8));
+  acc[2] = Round(acc[2], Load64(p + 16));
+  acc[3] = Round(acc[3], Load64(p + 24));
+}
+
+StateHash::StateHash(uint64_t seed)
+    : acc_{seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1},
+      buffered_(0),
+      length_(0),
+      seed_(seed) {}
+
+void StateHash::Update(const void *data, std::size_t size) {
+  const Byte *p = static_cast<const Byte *>(data);
+  length_ += size;
+
+  if (buffered_ + size < sizeof(buffer_)) {
+    std::memcpy(buffer_ + buffered_, p, size);
+    buffered_ += size;
+    return;
+  }
+
+  if (buffered_ > 0) {
+    std::size_t fill = sizeof(buffer_) - buffered_;
+    std::memcpy(buffer_ + buffered_, p, fill);
+    Stripe(acc_, buffer_);
+    p += fill;
+    size -= fill;
+    buffered_ = 0;
+  }
+
+  for (; size >= sizeof(buffer_); size -= sizeof(buffer_)) {
+    Stripe(acc_, p);
+    p += sizeof(buffer_);
+  }
+
+  std::memcpy(buffer_, p, size);
+  buffered_ = size;
+}
+
+uint64_t StateHash::Digest() const {
+  uint64_t hash;
+  if (length_ >= sizeof(buffer_)) {
+    hash = Rotl(acc_[0], 1) + Rotl(acc_[1], 7) + Rotl(acc_[2], 12) +
+           Rotl(acc_[3], 18);
+    for (uint64_t acc : acc_) {
+      hash = MergeRound(hash, acc);
+    }
+  } else {
+    hash = seed_ + kPrime5;
+  }
+  hash += length_;
+
+  const Byte *p = buffer_;
+  const Byte *end = buffer_ + buffered_;
+  for (; p + 8 <= end; p += 8) {
+    hash ^= Round(0, Load64(p));
+    hash = Rotl(hash, 27) * kPrime1 + kPrime4;
+  }
+  if (p + 4 <= end) {
+    hash ^= Load32(p) * kPrime1;
+    hash = Rotl(hash, 23) * kPrime2 + kPrime3;
+    p += 4;
+  }
+  for (; p < end; ++p) {
+    hash ^= *p * kPrime5;
+    hash = Rotl(hash, 11) * kPrime1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+}  // namespace hn
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <type_traits>
+
+#include "common.h"
+
+namespace hn {
+
+// XXH64 fed in pieces, for hashing the machine state without copying it into
+// one buffer first. The digest is the same as hashing all the pieces joined.
+class StateHash {
+ public:
+  explicit StateHash(uint64_t seed = 0);
+
+  void Update(const void *data, std::size_t size);
+  void Update(const Memory &memory) { Update(memory.data(), memory.size()); }
+  template <typename T>
+  void Add(const T &value) {
+    static_assert(std::is_scalar<T>::value,
+                  "Structs would be hashed with their padding");
+    Update(&value, sizeof(T));
+  }
+
+  uint64_t Digest() const;
+
+ private:
+  uint64_t acc_[4];
+  Byte buffer_[32];  // the part of a stripe not consumed yet
+  std::size_t buffered_;
+  uint64_t length_;
+  uint64_t seed_;
+};
+
+}  // namespace hn
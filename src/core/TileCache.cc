@@ -0,0 +1,50 @@
+#include "TileCache.h"
+
+namespace hn {
+TileCache::TileCache() { Invalidate(); }
+
+void TileCache::Invalidate(const Byte *ptr) {
+  for (auto &bank : banks_) {
+    if (bank.source && bank.source <= ptr && ptr < bank.source + 0x400) {
+      bank.decoded &= ~(std::uint64_t(1) << ((ptr - bank.source) >> 4));
+    }
+  }
+}
+
+void TileCache::Invalidate() {
+  for (auto &bank : banks_) {
+    bank.source = nullptr;
+    bank.decoded = 0;
+  }
+}
+
+//
+//    Character   Colors      Contents of Pattern Table
+//    ...*....    00010000    00010000 $10  +-> 00000000 $00
+//    ..O.O...    00202000    00000000 $00  |   00101000 $28
+//    .#...#..    03000300    01000100 $44  |   01000100 $44
+//    O.....O.    20000020    00000000 $00  |   10000010 $82
+//    *******. -> 11111110 -> 11111110 $FE  |   00000000 $00
+//    O.....O.    20000020    00000000 $00  |   10000010 $82
+//    #.....#.    30000030    10000010 $82  |   10000010 $82
+//    ........    00000000    00000000 $00  |   00000000 $00
+//                                +---------+
+//
+void TileCache::DecodeRow(Byte low, Byte high, Byte *pixels) {
+  for (int x = 0; x < 8; ++x) {
+    int shift = 7 - x;
+    pixels[x] = ((low >> shift) & 1) | (((high >> shift) & 1) << 1);
+  }
+}
+
+void TileCache::Decode(const Byte *pattern, Byte *pixels) {
+  for (int y = 0; y < 8; ++y) {
+    Byte *row = pixels + (y << 3), *flipped = row + 64;
+    DecodeRow(pattern[y], pattern[y + 8], row);
+    for (int x = 0; x < 8; ++x) {
+      flipped[x] = row[7 - x];
+    }
+  }
+}
+
+}  // namespace hn
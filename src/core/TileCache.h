@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+#include "common.h"
+
+namespace hn {
+constexpr int kTileBytes = 16;  // two bit planes of 8 bytes
+constexpr int kTilesInBank = 0x400 / kTileBytes;
+
+// Pattern tiles decoded from their bit planes into one color (0-3) per byte,
+// 8 rows of 8 pixels, followed by the same rows flipped horizontally.
+//
+// Tiles are cached per 1KB CHR bank slot and decoded on first use. Switching
+// the bank in a slot drops its tiles, writes to CHR RAM must be reported
+// through Invalidate().
+class TileCache {
+ public:
+  TileCache();
+
+  // Tile of the 1KB bank mapped at slot
+  const Byte *Tile(int slot, const Byte *bank, int tile) {
+    Bank &cached = banks_[slot];
+    if (cached.source != bank) {
+      cached.source = bank;
+      cached.decoded = 0;
+    }
+    if (!((cached.decoded >> tile) & 1)) {
+      Decode(bank + tile * kTileBytes, cached.pixels[tile]);
+      cached.decoded |= std::uint64_t(1) << tile;
+    }
+
+    return cached.pixels[tile];
+  }
+
+  // Row of pixels at pattern address addr, its bank mapped at addr too
+  const Byte *Row(const Byte *bank, Address addr, bool flip = false) {
+    return Tile((addr >> 10) & 0x7, bank, (addr >> 4) & (kTilesInBank - 1)) +
+           (flip ? 64 : 0) + ((addr & 0x7) << 3);
+  }
+
+  // Drops the tile holding the byte at ptr, wherever it is mapped
+  void Invalidate(const Byte *ptr);
+  void Invalidate();
+
+  static void DecodeRow(Byte low, Byte high, Byte *pixels);
+
+ private:
+  static void Decode(const Byte *pattern, Byte *pixels);
+
+  struct Bank {
+    const Byte *source;
+    std::uint64_t decoded;  // bit per tile
+    Byte pixels[kTilesInBank][128];
+  } banks_[8];
+};
+
+}  // namespace hn
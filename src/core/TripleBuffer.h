@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+
+namespace hn {
+
+// Lock-free handoff of the newest value from one producer thread to one
+// consumer thread. Each side owns one of the three buffers, the third is
+// swapped between them, so neither ever waits for the other and the
+// consumer skips the values it was too slow for.
+template <typename T>
+class TripleBuffer {
+ public:
+  TripleBuffer() : middle_(1), back_(0), front_(2) {}
+
+  // Sets every buffer, before the threads start
+  void Reset(const T &value) {
+    for (auto &buffer : buffers_) buffer = value;
+    middle_.store(1, std::memory_order_relaxed);
+    back_ = 0;
+    front_ = 2;
+  }
+
+  // Producer side: fill back() then publish it, it then gets another buffer
+  // which may hold anything
+  T &back() { return buffers_[back_]; }
+  void Publish() {
+    int old = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel);
+    back_ = old & kIndexMask;
+  }
+
+  // Consumer side: takes the newest published buffer, false if none was
+  // published since the last time
+  bool Update() {
+    if (!(middle_.load(std::memory_order_relaxed) & kFresh)) return false;
+
+    int old = middle_.exchange(front_, std::memory_order_acq_rel);
+    front_ = old & kIndexMask;
+    return true;
+  }
+  const T &front() const { return buffers_[front_]; }
+
+ private:
+  static constexpr int kIndexMask = 0x3;
+  static constexpr int kFresh = 0x4;
+
+  T buffers_[3];
+  // Index of the buffer in between, with kFresh while not taken yet
+  std::atomic<int> middle_;
+  int back_;   // producer only
+  int front_;  // consumer only
+};
+
+}  // namespace hn
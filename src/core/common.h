@@ -1,12 +1,15 @@
 #pragma once
 #include <algorithm>
+#include <array>
 #include <chrono>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <iterator>
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #define LEN_ARRAY(a) (sizeof(a) / sizeof(a[0]))
@@ -45,8 +48,8 @@ using TimePoint = std::chrono::high_resolution_clock::time_point;
 using Memory = std::vector<Byte>;
 using Image = std::vector<std::vector<Color>>;
 
-template <typename T>
-std::string DumpVector(const std::vector<T>& vec) {
+template <typename Container>
+std::string DumpVector(const Container& vec) {
   std::stringstream ss;
   ss << "[" << std::hex;
   int i = 0;
@@ -59,11 +62,78 @@ std::string DumpVector(const std::vector<T>& vec) {
   return ss.str();
 }
 
+// Flat buffer for in-memory snapshots, reused from one snapshot to the next.
+// Plain data is appended with one copy and read back in the same order
+class StateBuffer {
+ public:
+  void Clear() {
+    data_.clear();
+    pos_ = 0;
+  }
+  void Assign(const Byte* data, std::size_t size) {
+    data_.assign(data, data + size);
+    pos_ = 0;
+  }
+
+  void Append(const void* data, std::size_t size) {
+    std::size_t end = data_.size();
+    data_.resize(end + size);
+    std::memcpy(data_.data() + end, data, size);
+  }
+  std::size_t Take(void* data, std::size_t size) {
+    size = std::min(size, data_.size() - pos_);
+    std::memcpy(data, data_.data() + pos_, size);
+    pos_ += size;
+    return size;
+  }
+
+  template <typename T>
+  void Put(const T& data) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Only plain data goes into a snapshot");
+    Append(&data, sizeof(T));
+  }
+
+  template <typename T>
+  void Get(T& data) {
+    Take(&data, sizeof(T));
+  }
+
+  template <typename T>
+  void Put(const std::vector<T>& data) {
+    uint32_t size = static_cast<uint32_t>(data.size());
+    Append(&size, sizeof(size));
+    Append(data.data(), size * sizeof(T));
+  }
+
+  template <typename T>
+  void Get(std::vector<T>& data) {
+    uint32_t size = 0;
+    Take(&size, sizeof(size));
+    data.resize(static_cast<size_t>(size));
+    Take(data.data(), size * sizeof(T));
+  }
+
+  const Byte* data() const { return data_.data(); }
+  std::size_t size() const { return data_.size(); }
+  void Seek(std::size_t pos) { pos_ = std::min(pos, data_.size()); }
+
+ private:
+  Memory data_;
+  std::size_t pos_ = 0;
+};
+
 class Serialize {
  public:
   virtual void Save(std::ostream& os) = 0;
   virtual void Restore(std::istream& is) = 0;
 
+  // In-memory snapshot of the machine state, taken many times a second: plain
+  // data put into the buffer with one copy. Nothing for what is not machine
+  // state
+  virtual void SnapshotTo(StateBuffer& /*buffer*/) {}
+  virtual void RestoreFrom(StateBuffer& /*buffer*/) {}
+
  protected:
   template <typename T>
   void Write(std::ostream& os, T data) {
@@ -76,7 +146,7 @@ class Serialize {
   }
 
   template <typename T>
-  void Write(std::ostream& os, std::vector<T> data) {
+  void Write(std::ostream& os, const std::vector<T>& data) {
     uint32_t size = static_cast<uint32_t>(data.size());
     os.write(reinterpret_cast<const char*>(&size), sizeof(size));
     os.write(reinterpret_cast<const char*>(data.data()), size * sizeof(T));
@@ -90,6 +160,25 @@ class Serialize {
     is.read(reinterpret_cast<char*>(data.data()), size * sizeof(T));
   }
 
+  // Same layout as the vectors
+  template <typename T, std::size_t N>
+  void Write(std::ostream& os, const std::array<T, N>& data) {
+    uint32_t size = static_cast<uint32_t>(N);
+    os.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    os.write(reinterpret_cast<const char*>(data.data()), N * sizeof(T));
+  }
+
+  template <typename T, std::size_t N>
+  void Read(std::istream& is, std::array<T, N>& data) {
+    uint32_t size;
+    is.read(reinterpret_cast<char*>(&size), sizeof(size));
+    if (size != N) {
+      is.setstate(std::ios::failbit);
+      return;
+    }
+    is.read(reinterpret_cast<char*>(data.data()), N * sizeof(T));
+  }
+
   void WriteNum(std::ostream& os, uint32_t data) {
     os.write(reinterpret_cast<const char*>(&data), sizeof(data));
   }
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "../PeripheralDevices.h"
+#include "../common.h"
+
+namespace hn {
+
+// Devices for running without a display, audio or input
+
+class NullScreen : public VirtualScreen {
+ public:
+  virtual void create(unsigned int /*width*/, unsigned int /*height*/,
+                      float /*pixel_size*/, Color /*color*/) {}
+  virtual void setPixel(std::size_t /*x*/, std::size_t /*y*/,
+                        Color /*color*/) {}
+  virtual void setFrame(const Color * /*frame*/, std::size_t /*width*/,
+                        std::size_t /*height*/, Byte /*mask*/) {}
+  virtual void resize(float /*pixel_size*/) {}
+
+  virtual void setTip(const std::string & /*msg*/) {}
+};
+
+class NullSpeaker : public VirtualSpeaker {
+ public:
+  virtual void PushSample(std::int16_t * /*data*/, size_t /*count*/) {}
+  virtual void Play() {}
+  virtual void Stop() {}
+};
+
+// A connected joypad with no button pressed
+class NullJoypad : public VirtualJoypad {
+ public:
+  virtual Byte buttons() const { return 0; }
+  virtual void setKeyBindings(const JoypadInputConfig & /*keys*/) {}
+};
+
+}  // namespace hn
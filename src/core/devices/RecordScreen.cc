@@ -1,61 +1,30 @@
 #include "RecordScreen.h"
 
+#include <cstring>
 #include <fstream>
 
 #include "../PeripheralDevices.h"
 
 namespace hn {
 
-const Byte kBmpFileHeader[] = {
-    0x42, 0x4d, 0x36, 0xf1, 0x00, 0x00, 0x00, 0x00,  // BM, Flen
-    0x00, 0x00, 0x36, 0x01, 0x00, 0x00, 0x28, 0x00,  //
-    0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x10, 0xff,  //
-    0xff, 0xff, 0x01, 0x00, 0x08, 0x00, 0x00, 0x00,  //
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  //
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x00,  //
-    0x00, 0x00, 0x40, 0x00, 0x00, 0x00,
-    // Palette
-    0x66, 0x66, 0x66, 0xff, 0x88, 0x2a, 0x00, 0xff,  //
-    0xa7, 0x12, 0x14, 0xff, 0xa4, 0x00, 0x3b, 0xff,  //
-    0x7e, 0x00, 0x5c, 0xff, 0x40, 0x00, 0x6e, 0xff,  //
-    0x00, 0x06, 0x6c, 0xff, 0x00, 0x1d, 0x56, 0xff,  //
-    0x00, 0x35, 0x33, 0xff, 0x00, 0x48, 0x0b, 0xff,  //
-    0x00, 0x52, 0x00, 0xff, 0x08, 0x4f, 0x00, 0xff,  //
-    0x4d, 0x40, 0x00, 0xff, 0x00, 0x00, 0x00, 0xff,  //
-    0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0xff,  //
-    0xad, 0xad, 0xad, 0xff, 0xd9, 0x5f, 0x15, 0xff,  //
-    0xff, 0x40, 0x42, 0xff, 0xfe, 0x27, 0x75, 0xff,  //
-    0xcc, 0x1a, 0xa0, 0xff, 0x7b, 0x1e, 0xb7, 0xff,  //
-    0x20, 0x31, 0xb5, 0xff, 0x00, 0x4e, 0x99, 0xff,  //
-    0x00, 0x6d, 0x6b, 0xff, 0x00, 0x87, 0x38, 0xff,  //
-    0x00, 0x93, 0x0c, 0xff, 0x32, 0x8f, 0x00, 0xff,  //
-    0x8d, 0x7c, 0x00, 0xff, 0x00, 0x00, 0x00, 0xff,  //
-    0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0xff,  //
-    0xff, 0xfe, 0xff, 0xff, 0xff, 0xb0, 0x64, 0xff,  //
-    0xff, 0x90, 0x92, 0xff, 0xff, 0x76, 0xc6, 0xff,  //
-    0xff, 0x6a, 0xf3, 0xff, 0xcc, 0x6e, 0xfe, 0xff,  //
-    0x70, 0x81, 0xfe, 0xff, 0x22, 0x9e, 0xea, 0xff,  //
-    0x00, 0xbe, 0xbc, 0xff, 0x00, 0xd8, 0x88, 0xff,  //
-    0x30, 0xe4, 0x5c, 0xff, 0x82, 0xe0, 0x45, 0xff,  //
-    0xde, 0xcd, 0x48, 0xff, 0x4f, 0x4f, 0x4f, 0xff,  //
-    0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0xff,  //
-    0xff, 0xfe, 0xff, 0xff, 0xff, 0xdf, 0xc0, 0xff,  //
-    0xff, 0xd2, 0xd3, 0xff, 0xff, 0xc8, 0xe8, 0xff,  //
-    0xff, 0xc2, 0xfb, 0xff, 0xea, 0xc4, 0xfe, 0xff,  //
-    0xc5, 0xcc, 0xfe, 0xff, 0xa5, 0xd8, 0xf7, 0xff,  //
-    0x94, 0xe5, 0xe4, 0xff, 0x96, 0xef, 0xcf, 0xff,  //
-    0xab, 0xf4, 0xbd, 0xff, 0xcc, 0xf3, 0xb3, 0xff,  //
-    0xf2, 0xeb, 0xb5, 0xff, 0xb8, 0xb8, 0xb8, 0xff,  //
-    0x00, 0x00, 0x00, 0xff, 0x00, 0x00, 0x00, 0xff   //
-};
+constexpr int kBmpWidth = 256;
+constexpr int kBmpHeight = 240;
+constexpr std::size_t kBmpHeaderSize = 14 + 40;
+
+static Byte *PutLE(Byte *out, uint32_t value, int bytes) {
+  for (int i = 0; i < bytes; ++i) {
+    *out++ = static_cast<Byte>(value >> (8 * i));
+  }
+  return out;
+}
 
 RecordScreen::RecordScreen(const std::string &file_path)
-    : file_path_(file_path) {}
+    : converter_(PaletteConverter::BGRA8888), mask_(0), file_path_(file_path) {}
 RecordScreen::~RecordScreen() { SaveBMP(); }
 
 void RecordScreen::create(unsigned int width, unsigned int height,
                           float pixel_size, Color color) {
-  buffer_.resize(256 * 240);
+  buffer_.resize(kBmpWidth * kBmpHeight);
 
   if (screen_) screen_->create(width, height, pixel_size, color);
 }
@@ -66,6 +35,19 @@ void RecordScreen::setPixel(std::size_t x, std::size_t y, Color color) {
   if (screen_) screen_->setPixel(x, y, color);
 }
 
+void RecordScreen::setFrame(const Color *frame, std::size_t width,
+                            std::size_t height, Byte mask) {
+  // Same layout as the BMP rows
+  if (width == kBmpWidth && width * height == buffer_.size()) {
+    std::memcpy(buffer_.data(), frame, buffer_.size());
+    mask_ = mask;
+
+    if (screen_) screen_->setFrame(frame, width, height, mask);
+  } else {
+    VirtualScreen::setFrame(frame, width, height, mask);
+  }
+}
+
 void RecordScreen::resize(float pixel_size) {
   if (screen_) screen_->resize(pixel_size);
 }
@@ -80,11 +62,31 @@ void RecordScreen::SetOutScreen(VirtualScreen *screen) {
 
 VirtualScreen *RecordScreen::OutScreen() { return screen_.get(); }
 
+// 32-bit BGRA, rows from the top: the height is negative
 void RecordScreen::SaveBMP() {
-  std::ofstream file(file_path_);
-  file.write(reinterpret_cast<const char *>(&kBmpFileHeader[0]),
-             sizeof(kBmpFileHeader));
-  file.write(reinterpret_cast<const char *>(buffer_.data()), buffer_.size());
+  Memory bmp(kBmpHeaderSize + buffer_.size() * 4);
+  Byte *out = bmp.data();
+  *out++ = 'B';
+  *out++ = 'M';
+  out = PutLE(out, bmp.size(), 4);
+  out = PutLE(out, 0, 4);
+  out = PutLE(out, kBmpHeaderSize, 4);
+
+  out = PutLE(out, 40, 4);  // info header size
+  out = PutLE(out, kBmpWidth, 4);
+  out = PutLE(out, -kBmpHeight, 4);
+  out = PutLE(out, 1, 2);   // planes
+  out = PutLE(out, 32, 2);  // bits per pixel
+  out = PutLE(out, 0, 4);   // no compression
+  out = PutLE(out, buffer_.size() * 4, 4);
+  for (int i = 0; i < 4; ++i) {
+    out = PutLE(out, 0, 4);  // resolution and palette, none
+  }
+
+  converter_.Convert(buffer_.data(), buffer_.size(), mask_, out);
+
+  std::ofstream file(file_path_, std::ios::out | std::ios::binary);
+  file.write(reinterpret_cast<const char *>(bmp.data()), bmp.size());
   file.close();
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include "../PaletteConverter.h"
 #include "../PeripheralDevices.h"
 
 namespace hn {
@@ -12,6 +13,8 @@ class RecordScreen : public VirtualScreen {
   virtual void create(unsigned int width, unsigned int height, float pixel_size,
                       Color color);
   virtual void setPixel(std::size_t x, std::size_t y, Color color);
+  virtual void setFrame(const Color* frame, std::size_t width,
+                        std::size_t height, Byte mask);
   virtual void resize(float pixel_size);
 
   virtual void setTip(const std::string& msg);
@@ -23,7 +26,9 @@ class RecordScreen : public VirtualScreen {
   void SaveBMP();
 
  private:
+  PaletteConverter converter_;
   Memory buffer_;
+  Byte mask_;  // of the last frame
 
   std::string file_path_;
   std::unique_ptr<VirtualScreen> screen_;
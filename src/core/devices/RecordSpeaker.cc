@@ -1,6 +1,7 @@
 #include "RecordSpeaker.h"
 
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <iterator>
 #include <limits>
@@ -47,9 +48,13 @@ RecordSpeaker::RecordSpeaker(const std::string &filepath, unsigned int channel,
       file_path_(filepath),
       wav_file_(filepath, std::ios::in | std::ios::out | std::ios::trunc |
                               std::ios::binary) {
-  // Write wave file header
-  wav_file_.write(reinterpret_cast<const char *>(&kWaveFileHeader[0]),
-                  sizeof(kWaveFileHeader));
+  // Write wave file header, with the sample rate and the byte rate
+  Byte header[sizeof(kWaveFileHeader)];
+  std::copy(std::begin(kWaveFileHeader), std::end(kWaveFileHeader), header);
+  const DWord rates[] = {sample_rate, sample_rate * 2};
+  std::memcpy(&header[24], rates, sizeof(rates));
+
+  wav_file_.write(reinterpret_cast<const char *>(&header[0]), sizeof(header));
 }
 
 RecordSpeaker::~RecordSpeaker() {
@@ -73,6 +78,10 @@ void RecordSpeaker::PushSample(std::int16_t *data, size_t count) {
                   sizeof(std::int16_t) * count);
 }
 
+size_t RecordSpeaker::queuedSamples() const {
+  return speaker_ ? speaker_->queuedSamples() : 0;
+}
+
 void RecordSpeaker::SetOutSpeaker(VirtualSpeaker *speaker) {
   speaker_.reset(speaker);
 }
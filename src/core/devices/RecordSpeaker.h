@@ -17,6 +17,7 @@ class RecordSpeaker : public VirtualSpeaker {
 
   virtual void Play() override;
   virtual void Stop() override;
+  virtual size_t queuedSamples() const override;
 
   void SetOutSpeaker(VirtualSpeaker* speaker);
 
@@ -3,7 +3,7 @@
 #include "glog/logging.h"
 
 namespace hn {
-VirtualJoypadSfml::VirtualJoypadSfml() : keyStates_(0), input_() {}
+VirtualJoypadSfml::VirtualJoypadSfml() : input_(), sample_(0) {}
 
 void VirtualJoypadSfml::setKeyBindings(const JoypadInputConfig &keys) {
   input_ = keys;
@@ -15,25 +15,16 @@ void VirtualJoypadSfml::setKeyBindings(const JoypadInputConfig &keys) {
   }
 }
 
-void VirtualJoypadSfml::strobe(Byte b) {
-  strobe_ = (b & 1);
-  if (!strobe_) {
-    keyStates_ = 0;
-    for (int button = A, shift = 0; button < TotalButtons; ++button, ++shift) {
-      keyStates_ |= isPressed(button) << shift;
-    }
+void VirtualJoypadSfml::Sample() {
+  Byte states = 0;
+  for (int button = A, shift = 0; button < TotalButtons; ++button, ++shift) {
+    states |= isPressed(button) << shift;
   }
+  sample_.store(states, std::memory_order_relaxed);
 }
 
-Byte VirtualJoypadSfml::read() {
-  Byte ret;
-  if (strobe_) {
-    ret = isPressed(A);
-  } else {
-    ret = (keyStates_ & 1);
-    keyStates_ >>= 1;
-  }
-  return ret | 0x40;
+Byte VirtualJoypadSfml::buttons() const {
+  return sample_.load(std::memory_order_relaxed);
 }
 
 bool VirtualJoypadSfml::isPressed(int key) const {
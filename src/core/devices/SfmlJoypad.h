@@ -1,5 +1,6 @@
 #pragma once
 #include <SFML/Window.hpp>
+#include <atomic>
 #include <cstdint>
 
 #include "../PeripheralDevices.h"
@@ -7,21 +8,21 @@
 
 namespace hn {
 
+// The keyboard and joysticks are polled by Sample() on the window thread, the
+// emulation thread takes the last sample from buttons()
 class VirtualJoypadSfml : public VirtualJoypad {
  public:
   VirtualJoypadSfml();
 
-  virtual void strobe(Byte b);
-  virtual Byte read();
+  void Sample();
+  virtual Byte buttons() const;
   virtual void setKeyBindings(const JoypadInputConfig &keys);
 
  protected:
   bool isPressed(int key) const;
 
  private:
-  bool strobe_;
-  unsigned int keyStates_;
-
   JoypadInputConfig input_;
+  std::atomic<Byte> sample_;
 };
 }  // namespace hn
@@ -1,15 +1,28 @@
 #pragma once
 #include <SFML/Graphics.hpp>
+#include <mutex>
+#include "../PaletteConverter.h"
 #include "../PeripheralDevices.h"
+#include "../TripleBuffer.h"
 
 namespace hn {
+// Frames may be set on another thread than the one drawing the screen. A
+// frame set pixel by pixel has to set all of them, it is shown once the last
+// one, at the bottom right, is set
 class VirtualScreenSfml : public VirtualScreen, public sf::Drawable {
  public:
-  VirtualScreenSfml() : VirtualScreen(), sf::Drawable() {}
+  VirtualScreenSfml()
+      : VirtualScreen(),
+        sf::Drawable(),
+        converter_(PaletteConverter::RGBA8888),
+        counter_(0),
+        newTip_(false) {}
 
   virtual void create(unsigned int width, unsigned int height, float pixel_size,
                       Color color);
   virtual void setPixel(std::size_t x, std::size_t y, Color color);
+  virtual void setFrame(const Color *frame, std::size_t width,
+                        std::size_t height, Byte mask);
   virtual void resize(float pixel_size);
 
   virtual void setTip(const std::string &msg);
@@ -19,10 +32,21 @@ class VirtualScreenSfml : public VirtualScreen, public sf::Drawable {
 
   sf::Vector2u screenSize_;
   float pixelSize_;  // virtual pixel size in real pixels
-  sf::VertexArray vertices_;
+  PaletteConverter converter_;
+
+  // RGBA frames, converted and published where they are set and taken by
+  // draw(). The newest one is uploaded to the texture, drawn as one sprite
+  // scaled by the pixel size
+  mutable TripleBuffer<std::vector<sf::Uint8>> frames_;
+  mutable sf::Texture texture_;
+  sf::Sprite sprite_;
 
   sf::Font font_;
   mutable sf::Text tipText_;
   mutable int counter_;
+  // Set by setTip, shown by draw()
+  mutable std::mutex tipMutex_;
+  std::string tip_;
+  mutable bool newTip_;
 };
 }  // namespace hn
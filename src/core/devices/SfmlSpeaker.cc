@@ -9,36 +9,35 @@
 namespace hn {
 
 constexpr size_t kSampleLeastSize = 1024;
+// About 190ms at 44100Hz, samples pushed beyond it are dropped
+constexpr size_t kQueueSize = 8192;
+
 VirtualSpeakerSfml::VirtualSpeakerSfml(unsigned int channel,
                                        unsigned int sample_rate)
-    : VirtualSpeaker(channel, sample_rate), queue_index_(0) {
-  queue_buffer_.resize(40);
-  mute_sample_.resize(kSampleLeastSize * 2, 0);
-  chunk_.samples = mute_sample_.data();
-  chunk_.sampleCount = kSampleLeastSize;
-
+    : VirtualSpeaker(channel, sample_rate),
+      queue_(kQueueSize),
+      chunk_buffer_(kSampleLeastSize, 0) {
   initialize(channel, sample_rate);
   setLoop(true);
 }
 
 void VirtualSpeakerSfml::PushSample(std::int16_t *data, size_t count) {
-  auto &current_buffer = queue_buffer_[queue_index_];
-  if (current_buffer.size() >= kSampleLeastSize) {
-    chunk_.samples = current_buffer.data();
-    chunk_.sampleCount = current_buffer.size();
-    if (++queue_index_ >= queue_buffer_.size()) {
-      queue_index_ = 0;
-    }
-
-    queue_buffer_[queue_index_].clear();
-  } else {
-    std::copy(data, data + count, std::back_inserter(current_buffer));
+  size_t pushed = queue_.Push(data, count);
+  if (pushed < count) {
+    VLOG(12) << "overrun, " << count - pushed << " samples dropped";
   }
 }
 
 bool VirtualSpeakerSfml::onGetData(sf::SoundStream::Chunk &data) {
-  data = chunk_;
-  VLOG(12) << "get " << chunk_.samples[2] << " ~ " << chunk_.sampleCount;
+  size_t count = queue_.Pop(chunk_buffer_.data(), chunk_buffer_.size());
+  if (count < chunk_buffer_.size()) {
+    // Underrun, play silence for the rest of the chunk
+    VLOG(12) << "underrun, " << count << " samples available";
+    std::fill(chunk_buffer_.begin() + count, chunk_buffer_.end(), 0);
+  }
+
+  data.samples = chunk_buffer_.data();
+  data.sampleCount = chunk_buffer_.size();
   return true;
 }
 
@@ -48,4 +47,6 @@ void VirtualSpeakerSfml::onSeek(sf::Time timeOffset) {
 
 void VirtualSpeakerSfml::Play() { play(); }
 void VirtualSpeakerSfml::Stop() { stop(); }
+
+size_t VirtualSpeakerSfml::queuedSamples() const { return queue_.size(); }
 }  // namespace hn
@@ -2,6 +2,7 @@
 
 #include <SFML/Audio.hpp>
 #include "../PeripheralDevices.h"
+#include "../SpscRingBuffer.h"
 
 namespace hn {
 
@@ -15,17 +16,17 @@ class VirtualSpeakerSfml : public VirtualSpeaker, public sf::SoundStream {
 
   virtual void Play();
   virtual void Stop();
+  virtual size_t queuedSamples() const;
 
  protected:
   virtual bool onGetData(sf::SoundStream::Chunk &data);
   virtual void onSeek(sf::Time timeOffset);
 
  private:
-  size_t queue_index_;
-  std::vector<int16_t> mute_sample_;
-  std::vector<std::vector<int16_t>> queue_buffer_;
-
-  sf::SoundStream::Chunk chunk_;
+  // Filled by the emulation thread, drained by the SFML audio thread
+  SpscRingBuffer<int16_t> queue_;
+  // Handed to SFML, which reads it until the next onGetData call
+  std::vector<int16_t> chunk_buffer_;
 };
 
 }  // namespace hn
@@ -2,11 +2,8 @@
 
 namespace hn {
 std::string Helper::root_path_ = "record";
-std::string Helper::tag_ = "fcgame";
 std::string Helper::rootPath() { return root_path_; }
 void Helper::setRootPath(const std::string& rootPath) { root_path_ = rootPath; }
-std::string Helper::tag() { return tag_; }
-void Helper::setTag(const std::string& tag) { tag_ = tag; }
 
 std::string Helper::Timemark() {
   char buffer[1024];
@@ -19,37 +16,45 @@ std::string Helper::Timemark() {
   return std::string(buffer);
 }
 
-std::string Helper::SequenceImageName() {
+std::string Helper::SequenceImageName(const std::string& tag) {
   char buffer[1024];
-  sprintf(buffer, "%s/tmp/%s-capture-%s.bmp", root_path_.c_str(), tag_.c_str(),
-          Timemark().c_str());
+  sprintf(buffer, "%s/tmp/%s-capture-%s.bmp", root_path_.c_str(),
+          tag.c_str(), Timemark().c_str());
 
   return std::string(buffer);
 }
 
-std::string Helper::GenSoundRecordName() {
+std::string Helper::GenSoundRecordName(const std::string& tag) {
   char buffer[1024];
-  sprintf(buffer, "%s/snds/%s-capture-%s.wav", root_path_.c_str(), tag_.c_str(),
-          Timemark().c_str());
+  sprintf(buffer, "%s/snds/%s-capture-%s.wav", root_path_.c_str(),
+          tag.c_str(), Timemark().c_str());
 
   return std::string(buffer);
 }
 
-std::string Helper::GenImageCaptureName() {
+std::string Helper::GenInputRecordName(const std::string& tag) {
   char buffer[1024];
-  sprintf(buffer, "%s/pics/%s-capture-%s.png", root_path_.c_str(), tag_.c_str(),
+  sprintf(buffer, "%s/save/%s-input-%s.rec", root_path_.c_str(), tag.c_str(),
           Timemark().c_str());
 
   return std::string(buffer);
 }
 
+std::string Helper::GenImageCaptureName(const std::string& tag) {
+  char buffer[1024];
+  sprintf(buffer, "%s/pics/%s-capture-%s.png", root_path_.c_str(),
+          tag.c_str(), Timemark().c_str());
+
+  return std::string(buffer);
+}
+
 std::string Helper::SearchDefaultFont() {
   return "/usr/share/fonts/truetype/freefont/FreeMonoBold.ttf";
 }
 
-std::string Helper::NewFileName(const std::string& hint) {
+std::string Helper::NewFileName(const std::string& tag) {
   char buffer[1024];
-  sprintf(buffer, "%s/save/%s-%s.sav", root_path_.c_str(), tag_.c_str(),
+  sprintf(buffer, "%s/save/%s-%s.sav", root_path_.c_str(), tag.c_str(),
           Timemark().c_str());
   return std::string(buffer);
 }
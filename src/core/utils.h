@@ -6,23 +6,20 @@ namespace hn {
 
 class Helper {
  public:
-  static std::string GenImageCaptureName();
+  static std::string GenImageCaptureName(const std::string &tag);
   static std::string SearchDefaultFont();
-  static std::string NewFileName(const std::string &hint);
+  static std::string NewFileName(const std::string &tag);
 
   static std::string Timemark();
-  static std::string SequenceImageName();
-  static std::string GenSoundRecordName();
+  static std::string SequenceImageName(const std::string &tag);
+  static std::string GenSoundRecordName(const std::string &tag);
+  static std::string GenInputRecordName(const std::string &tag);
 
   static std::string rootPath();
   static void setRootPath(const std::string &rootPath);
 
-  static std::string tag();
-  static void setTag(const std::string &tag);
-
  private:
   static std::string root_path_;
-  static std::string tag_;
 };
 
 extern void parseControllerConf(std::string filepath, JoypadInputConfig &p1,
@@ -0,0 +1,65 @@
+#include <fstream>
+#include <iostream>
+
+#include "core/EmulatorHeadless.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+DEFINE_string(record, "", "Specify the recording file to replay");
+DEFINE_uint64(frames, 0,
+              "Specify the number of frames to run, 0 runs until the replay "
+              "finishes");
+DEFINE_bool(catchup, false,
+            "Run the CPU an instruction at a time and catch up the other "
+            "devices lazily");
+DEFINE_bool(capture, false, "Save the last frame and the sound to files");
+DEFINE_int32(sample_rate, 44100, "Set the sample rate of the captured sound");
+DEFINE_uint64(seek, 0,
+              "Start the replay at this frame, from the keyframe before it");
+DEFINE_int32(frameskip, 0,
+             "Skip the picture of N frames out of every N+1, the game runs "
+             "the same");
+DEFINE_string(hash_log, "",
+              "Write the state hash of every frame to this file, for diffing "
+              "two runs");
+
+int main(int argc, char **argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  hn::Cartridge cart;
+  if (argc < 2) {
+    LOG(ERROR) << "Argument required: ROM path" << std::endl;
+    return 1;
+  }
+
+  for (int i = 1; i < argc; i++) {
+    if (!cart.loadFromFile(argv[i])) {
+      LOG(ERROR) << "Load ROM failed: " << argv[i] << std::endl;
+
+      return 1;
+    }
+  }
+
+  hn::EmulatorHeadless emulator(FLAGS_capture, FLAGS_sample_rate);
+  emulator.setCartridge(cart);
+  emulator.setFrameCount(FLAGS_frames);
+  emulator.setSeekFrame(FLAGS_seek);
+  emulator.setFrameSkip(FLAGS_frameskip, FLAGS_frameskip + 1);
+
+  emulator.SetRecordMode(!FLAGS_record.empty(), FLAGS_record);
+  emulator.setScheduler(FLAGS_catchup ? hn::Emulator::CATCH_UP
+                                      : hn::Emulator::CYCLE_STEP);
+
+  std::ofstream hash_log;
+  if (!FLAGS_hash_log.empty()) {
+    hash_log.open(FLAGS_hash_log);
+    emulator.setHashLog(&hash_log);
+  }
+
+  emulator.run();
+  std::cout << emulator.framesRun() << " frames in " << emulator.seconds()
+            << "s, " << emulator.framesRun() / emulator.seconds() << " fps"
+            << std::endl;
+
+  return 0;
+}
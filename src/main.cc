@@ -6,6 +6,9 @@
 DEFINE_bool(replaying, false, "Specify replaying mode");
 DEFINE_bool(print, false, "Specify the verboss inform output");
 DEFINE_string(record, "", "Specify recording file");
+DEFINE_bool(catchup, false,
+            "Run the CPU an instruction at a time and catch up the other "
+            "devices lazily");
 DEFINE_double(vrate, -1, "Set the pixel scale of the emulation screen");
 DEFINE_int32(width, -1,
              "Set the width of the emulation screen (height is set "
@@ -13,6 +16,13 @@ DEFINE_int32(width, -1,
 DEFINE_int32(height, -1,
              "Set the height of the emulation screen (width is set "
              "automatically to fit the aspect ratio)");
+DEFINE_int32(sample_rate, 44100, "Set the sample rate of the sound output");
+DEFINE_string(pacing, "audio",
+              "Follow the audio, the display (vsync) or a timer to run the "
+              "frames");
+DEFINE_int32(run_ahead, 0,
+             "Show the frame that many frames ahead to hide the input lag of "
+             "the game, up to 3");
 
 int main(int argc, char **argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
@@ -41,7 +51,7 @@ int main(int argc, char **argv) {
                   sf::Keyboard::Left,    sf::Keyboard::Right};
   hn::parseControllerConf("keybindings.conf", p1, p2);
 
-  hn::EmulatorSfml emulator;
+  hn::EmulatorSfml emulator(FLAGS_sample_rate);
   emulator.setKeys(p1, p2);
   emulator.setVideoScale(FLAGS_vrate);
   emulator.setVideoWidth(FLAGS_width);
@@ -49,6 +59,19 @@ int main(int argc, char **argv) {
   emulator.setCartridge(cart);
 
   emulator.SetRecordMode(FLAGS_replaying, FLAGS_record);
+  emulator.setScheduler(FLAGS_catchup ? hn::Emulator::CATCH_UP
+                                      : hn::Emulator::CYCLE_STEP);
+  if (FLAGS_pacing == "audio") {
+    emulator.setPacing(hn::FramePacer::AUDIO);
+  } else if (FLAGS_pacing == "vsync") {
+    emulator.setPacing(hn::FramePacer::VSYNC);
+  } else if (FLAGS_pacing == "timer") {
+    emulator.setPacing(hn::FramePacer::TIMER);
+  } else {
+    LOG(ERROR) << "Unknown pacing: " << FLAGS_pacing;
+    return 1;
+  }
+  emulator.setRunAhead(FLAGS_run_ahead);
 
   emulator.run();
 
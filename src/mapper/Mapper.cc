@@ -85,7 +85,35 @@ void Mapper::ChangeNTMirroring(NameTableMirroring mirror) {
 void Mapper::ResetVRam(size_t size) {
   vRam_.resize(size);
   std::fill(vRam_.begin(), vRam_.end(), 0);
+  InvalidateTiles();
 }
+
+void Mapper::InvalidateTiles() {
+  if (cartridge_.bus() && cartridge_.bus()->ppu()) {
+    cartridge_.bus()->ppu()->bus().invalidateTiles();
+  }
+}
+// Bank numbers past the end of the memory wrap around, as the upper address
+// lines would be left unconnected on the board
+void Mapper::MapPRG(int slot, FileAddress offset, int count) {
+  const Memory &rom = cartridge_.getROM();
+  for (int i = 0; i < count; ++i, offset += 0x2000) {
+    prgWindows_[slot + i] = rom.empty() ? nullptr : &rom[offset % rom.size()];
+  }
+
+  if (cartridge_.bus()) {
+    cartridge_.bus()->updatePRGPages();
+  }
+}
+
+void Mapper::MapCHR(int slot, const Memory &memory, FileAddress offset,
+                    int count) {
+  for (int i = 0; i < count; ++i, offset += 0x400) {
+    chrWindows_[slot + i] =
+        memory.empty() ? nullptr : &memory[offset % memory.size()];
+  }
+}
+
 void Mapper::FireIRQ() { cartridge_.bus()->cpu()->TryIRQ(); }
 void Mapper::StopIRQ() { cartridge_.bus()->cpu()->ClearIRQ(); }
 
@@ -98,5 +126,17 @@ void Mapper::Restore(std::istream &is) {
   Read(is, type_);
 
   Read(is, vRam_);
+  InvalidateTiles();
+}
+
+void Mapper::SnapshotTo(StateBuffer &buffer) {
+  buffer.Put(type_);
+  buffer.Put(vRam_);
+}
+
+void Mapper::RestoreFrom(StateBuffer &buffer) {
+  buffer.Get(type_);
+  buffer.Get(vRam_);
+  InvalidateTiles();
 }
 }  // namespace hn
@@ -21,7 +21,8 @@ enum NameTableMirroring {
 //
 class Mapper : public Serialize {
  public:
-  Mapper(Cartridge &cart, Word t) : cartridge_(cart), type_(t){};
+  Mapper(Cartridge &cart, Word t)
+      : cartridge_(cart), type_(t), prgWindows_(), chrWindows_(){};
 
   virtual void Reset() = 0;
   virtual void writePRG(Address addr, Byte value) = 0;
@@ -43,21 +44,55 @@ class Mapper : public Serialize {
 
   virtual void Hsync(int scanline) {}
   virtual void Tick() {}
+  // Mappers overriding Tick() return true, so that the emulator keeps them
+  // in lockstep with the CPU instead of catching them up lazily
+  virtual bool clockedByCPU() const { return false; }
 
   virtual void Save(std::ostream &os) override;
   virtual void Restore(std::istream &is) override;
+  // The registers of the mappers are plain data bases, put with one copy. The
+  // banks are mapped again after a restore
+  virtual void SnapshotTo(StateBuffer &buffer) override;
+  virtual void RestoreFrom(StateBuffer &buffer) override;
 
   Memory &VRAM() { return vRam_; }
 
+  // Banks currently switched in, as 8KB PRG windows over $8000-$FFFF and 1KB
+  // CHR windows over $0000-$1FFF. The buses read through them directly, a
+  // null window falls back to readPRG/readCHR
+  const Byte *prgWindow(Address addr) const {
+    return prgWindows_[(addr >> 13) & 0x3];
+  }
+  const Byte *chrWindow(Address addr) const {
+    return chrWindows_[(addr >> 10) & 0x7];
+  }
+
  protected:
+  // Maps count 8KB banks of PRG ROM, starting at offset, from window slot on
+  void MapPRG(int slot, FileAddress offset, int count = 1);
+  // Maps count 1KB banks of memory (CHR ROM or RAM) from window slot on
+  void MapCHR(int slot, const Memory &memory, FileAddress offset,
+              int count = 1);
   void ChangeNTMirroring(NameTableMirroring mirror);
   void FireIRQ();
   void StopIRQ();
   void ResetVRam(size_t size = 0x2000);
+  // Drops the tiles the PPU decoded from vRam_ after changing it directly
+  void InvalidateTiles();
+  // Zeroes the plain state of the mapper with its padding, which is hashed
+  // along with the snapshots
+  template <typename State>
+  void ClearState(State *state) {
+    std::memset(state, 0, sizeof(State));
+  }
 
   Cartridge &cartridge_;
   Word type_;
 
   Memory vRam_;
+
+ private:
+  const Byte *prgWindows_[4];
+  const Byte *chrWindows_[8];
 };
 }  // namespace hn
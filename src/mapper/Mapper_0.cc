@@ -2,7 +2,9 @@
 #include "glog/logging.h"
 
 namespace hn {
-Mapper_0::Mapper_0(Cartridge &cart) : Mapper(cart, 0) {}
+Mapper_0::Mapper_0(Cartridge &cart) : Mapper(cart, 0) {
+  ClearState<Mapper0State>(this);
+}
 void Mapper_0::Reset() {
   if (cartridge_.getROM().size() == 0x4000) {  // 1 bank
     oneBank_ = true;
@@ -16,6 +18,19 @@ void Mapper_0::Reset() {
     ResetVRam();
     LOG(INFO) << "Uses character RAM";
   }
+
+  updateWindows();
+}
+
+void Mapper_0::updateWindows() {
+  if (oneBank_) {
+    MapPRG(0, 0, 2);
+    MapPRG(2, 0, 2);
+  } else {
+    MapPRG(0, 0, 4);
+  }
+
+  MapCHR(0, usesCharacterRAM_ ? vRam_ : cartridge_.getVROM(), 0, 8);
 }
 
 Byte Mapper_0::readPRG(Address addr) {
@@ -64,6 +79,20 @@ void Mapper_0::Restore(std::istream &is) {
 
   Read(is, oneBank_);
   Read(is, usesCharacterRAM_);
+
+  updateWindows();
+}
+
+void Mapper_0::SnapshotTo(StateBuffer &buffer) {
+  Mapper::SnapshotTo(buffer);
+  buffer.Put(static_cast<const Mapper0State &>(*this));
+}
+
+void Mapper_0::RestoreFrom(StateBuffer &buffer) {
+  Mapper::RestoreFrom(buffer);
+  buffer.Get(static_cast<Mapper0State &>(*this));
+
+  updateWindows();
 }
 
 }  // namespace hn
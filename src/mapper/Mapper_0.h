@@ -3,7 +3,13 @@
 #include "Mapper.h"
 
 namespace hn {
-class Mapper_0 : public Mapper {
+// Registers of the mapper, plain data for one-copy snapshots
+struct Mapper0State {
+  bool oneBank_;
+  bool usesCharacterRAM_;
+};
+
+class Mapper_0 : public Mapper, private Mapper0State {
  public:
   Mapper_0(Cartridge &cart);
   virtual void Reset() override;
@@ -18,9 +24,10 @@ class Mapper_0 : public Mapper {
 
   virtual void Save(std::ostream &os) override;
   virtual void Restore(std::istream &is) override;
+  virtual void SnapshotTo(StateBuffer &buffer) override;
+  virtual void RestoreFrom(StateBuffer &buffer) override;
 
  private:
-  bool oneBank_;
-  bool usesCharacterRAM_;
+  void updateWindows();
 };
 }  // namespace hn
@@ -5,7 +5,9 @@
 namespace hn {
 constexpr size_t kPRGPageSize = 0x4000;
 
-Mapper_1::Mapper_1(Cartridge &cart) : Mapper(cart, 1) {}
+Mapper_1::Mapper_1(Cartridge &cart) : Mapper(cart, 1) {
+  ClearState<Mapper1State>(this);
+}
 
 void Mapper_1::Reset() {
   modeCHR_ = 0;
@@ -35,6 +37,8 @@ void Mapper_1::Reset() {
   secondBankPRG_ =
       &cartridge_.getROM()[cartridge_.getROM().size() - kPRGPageSize];
   /*0x2000 * 0x0e*/  // last bank
+
+  updateWindows();
 }
 
 Byte Mapper_1::readPRG(Address addr) {
@@ -52,6 +56,7 @@ void Mapper_1::writePRG(Address addr, Byte value) {
     writeCounter_ = 0;
     modePRG_ = 3;
     calculatePRGPointers();
+    updateWindows();
   } else {
     tempRegister_ = (tempRegister_ >> 1) | ((value & 1) << 4);
     ++writeCounter_;
@@ -78,17 +83,7 @@ void Mapper_1::writePRG(Address addr, Byte value) {
         modeCHR_ = (tempRegister_ & 0x10) >> 4;
         modePRG_ = (tempRegister_ & 0xc) >> 2;
         calculatePRGPointers();
-
-        // Recalculate CHR pointers
-        if (modeCHR_ == 0) {  // one 8KB bank
-          firstBankCHR_ =
-              &cartridge_
-                   .getVROM()[0x1000 * (regCHR0_ | 1)];  // ignore last bit
-          secondBankCHR_ = firstBankCHR_ + 0x1000;
-        } else {  // two 4KB banks
-          firstBankCHR_ = &cartridge_.getVROM()[0x1000 * regCHR0_];
-          secondBankCHR_ = &cartridge_.getVROM()[0x1000 * regCHR1_];
-        }
+        calculateCHRPointers();
       } else if (addr <= 0xbfff) {  // CHR Reg 0
         regCHR0_ = tempRegister_;
         firstBankCHR_ =
@@ -111,6 +106,7 @@ void Mapper_1::writePRG(Address addr, Byte value) {
         calculatePRGPointers();
       }
 
+      updateWindows();
       tempRegister_ = 0;
       writeCounter_ = 0;
     }
@@ -133,6 +129,32 @@ void Mapper_1::calculatePRGPointers() {
   }
 }
 
+void Mapper_1::calculateCHRPointers() {
+  if (modeCHR_ == 0) {  // one 8KB bank
+    firstBankCHR_ =
+        &cartridge_.getVROM()[0x1000 * (regCHR0_ | 1)];  // ignore last bit
+    secondBankCHR_ = firstBankCHR_ + 0x1000;
+  } else {  // two 4KB banks
+    firstBankCHR_ = &cartridge_.getVROM()[0x1000 * regCHR0_];
+    secondBankCHR_ = &cartridge_.getVROM()[0x1000 * regCHR1_];
+  }
+}
+
+// Publishes the banks selected by the pointers above to the buses
+void Mapper_1::updateWindows() {
+  const Byte *rom = cartridge_.getROM().data();
+  MapPRG(0, firstBankPRG_ - rom, 2);
+  MapPRG(2, secondBankPRG_ - rom, 2);
+
+  if (usesCharacterRAM_) {
+    MapCHR(0, vRam_, 0, 8);
+  } else {
+    const Byte *vrom = cartridge_.getVROM().data();
+    MapCHR(0, cartridge_.getVROM(), firstBankCHR_ - vrom, 4);
+    MapCHR(4, cartridge_.getVROM(), secondBankCHR_ - vrom, 4);
+  }
+}
+
 Byte Mapper_1::readCHR(Address addr) {
   if (usesCharacterRAM_) {
     return vRam_[addr];
@@ -186,6 +208,26 @@ void Mapper_1::Restore(std::istream &is) {
   Read(is, regCHR1_);
 
   calculatePRGPointers();
+  if (!usesCharacterRAM_) {
+    calculateCHRPointers();
+  }
+  updateWindows();
+}
+
+void Mapper_1::SnapshotTo(StateBuffer &buffer) {
+  Mapper::SnapshotTo(buffer);
+  buffer.Put(static_cast<const Mapper1State &>(*this));
+}
+
+void Mapper_1::RestoreFrom(StateBuffer &buffer) {
+  Mapper::RestoreFrom(buffer);
+  buffer.Get(static_cast<Mapper1State &>(*this));
+
+  calculatePRGPointers();
+  if (!usesCharacterRAM_) {
+    calculateCHRPointers();
+  }
+  updateWindows();
 }
 
 }  // namespace hn
@@ -2,7 +2,21 @@
 #include "Mapper.h"
 
 namespace hn {
-class Mapper_1 : public Mapper {
+// Registers of the mapper, plain data for one-copy snapshots
+struct Mapper1State {
+  bool usesCharacterRAM_;
+  int modeCHR_;
+  int modePRG_;
+
+  Byte tempRegister_;
+  int writeCounter_;
+
+  Byte regPRG_;
+  Byte regCHR0_;
+  Byte regCHR1_;
+};
+
+class Mapper_1 : public Mapper, private Mapper1State {
  public:
   Mapper_1(Cartridge &cart);
 
@@ -17,20 +31,13 @@ class Mapper_1 : public Mapper {
 
   virtual void Save(std::ostream &os) override;
   virtual void Restore(std::istream &is) override;
+  virtual void SnapshotTo(StateBuffer &buffer) override;
+  virtual void RestoreFrom(StateBuffer &buffer) override;
 
  private:
   void calculatePRGPointers();
-
-  bool usesCharacterRAM_;
-  int modeCHR_;
-  int modePRG_;
-
-  Byte tempRegister_;
-  int writeCounter_;
-
-  Byte regPRG_;
-  Byte regCHR0_;
-  Byte regCHR1_;
+  void calculateCHRPointers();
+  void updateWindows();
 
   const Byte *firstBankPRG_;
   const Byte *secondBankPRG_;
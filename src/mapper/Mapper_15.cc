@@ -4,10 +4,11 @@
 
 namespace hn {
 
-Mapper_15::Mapper_15(Cartridge &cart) : Mapper(cart, 15) {}
+Mapper_15::Mapper_15(Cartridge &cart) : Mapper(cart, 15) {
+  ClearState<Mapper15State>(this);
+}
 
 void Mapper_15::Reset() {
-  bankAddr_.resize(4);
   bankAddr_[0] = 0;
   bankAddr_[1] = 1;
   bankAddr_[2] = 2;
@@ -19,6 +20,14 @@ void Mapper_15::Reset() {
   chrVRam_ = true;
 
   ChangeNTMirroring(Vertical);
+  mapPRGBanks();
+  MapCHR(0, vRam_, 0, 8);
+}
+
+void Mapper_15::mapPRGBanks() {
+  for (int i = 0; i < 4; ++i) {
+    MapPRG(i, bankAddr_[i] << 13);
+  }
 }
 
 void Mapper_15::writePRG(Address addr, Byte data) {
@@ -50,6 +59,7 @@ void Mapper_15::writePRG(Address addr, Byte data) {
       bankAddr_[3] = (taddr << 1) + swap;
       break;
   }
+  mapPRGBanks();
 
   ChangeNTMirroring((data & 0x40) ? Horizontal : Vertical);
 }
@@ -93,4 +103,16 @@ void Mapper_15::DebugDump() {
   LOG(INFO) << "Mapper 15 mode:" << +prgBankMode_ << " bankAddr:" << std::hex
             << DumpVector(bankAddr_);
 }
+
+void Mapper_15::SnapshotTo(StateBuffer &buffer) {
+  Mapper::SnapshotTo(buffer);
+  buffer.Put(static_cast<const Mapper15State &>(*this));
+}
+
+void Mapper_15::RestoreFrom(StateBuffer &buffer) {
+  Mapper::RestoreFrom(buffer);
+  buffer.Get(static_cast<Mapper15State &>(*this));
+
+  mapPRGBanks();
+}
 };  // namespace hn
@@ -3,7 +3,16 @@
 #include "Mapper.h"
 
 namespace hn {
-class Mapper_15 : public Mapper {
+// Registers of the mapper, plain data for one-copy snapshots
+struct Mapper15State {
+  Byte prgBankMode_;
+  std::array<FileAddress, 4> bankAddr_;
+  Byte prgRom_;
+  bool chrVRam_;
+  bool protectCHR_;
+};
+
+class Mapper_15 : public Mapper, private Mapper15State {
  public:
   Mapper_15(Cartridge &cart);
 
@@ -18,13 +27,12 @@ class Mapper_15 : public Mapper {
 
   virtual void DebugDump() override;
 
+  virtual void SnapshotTo(StateBuffer &buffer) override;
+  virtual void RestoreFrom(StateBuffer &buffer) override;
+
  protected:
  private:
-  Byte prgBankMode_;
-  std::vector<FileAddress> bankAddr_;
-  Byte prgRom_;
-  bool chrVRam_;
-  bool protectCHR_;
+  void mapPRGBanks();
 };
 
 }  // namespace hn
@@ -2,7 +2,9 @@
 #include "glog/logging.h"
 
 namespace hn {
-Mapper_2::Mapper_2(Cartridge &cart) : Mapper(cart, 2) {}
+Mapper_2::Mapper_2(Cartridge &cart) : Mapper(cart, 2) {
+  ClearState<Mapper2State>(this);
+}
 
 void Mapper_2::Reset() {
   selectPRG_ = 0;
@@ -15,6 +17,14 @@ void Mapper_2::Reset() {
   }
 
   lastBankPtr_ = &cartridge_.getROM()[cartridge_.getROM().size() - 0x4000];
+  updateWindows();
+}
+
+void Mapper_2::updateWindows() {
+  MapPRG(0, selectPRG_ << 14, 2);
+  MapPRG(2, cartridge_.getROM().size() - 0x4000, 2);
+
+  MapCHR(0, usesCharacterRAM_ ? vRam_ : cartridge_.getVROM(), 0, 8);
 }
 
 Byte Mapper_2::readPRG(Address addr) {
@@ -25,7 +35,10 @@ Byte Mapper_2::readPRG(Address addr) {
   }
 }
 
-void Mapper_2::writePRG(Address addr, Byte value) { selectPRG_ = value; }
+void Mapper_2::writePRG(Address addr, Byte value) {
+  selectPRG_ = value;
+  MapPRG(0, selectPRG_ << 14, 2);
+}
 
 Byte Mapper_2::readCHR(Address addr) {
   if (usesCharacterRAM_) {
@@ -56,6 +69,20 @@ void Mapper_2::Restore(std::istream &is) {
   Read(is, selectPRG_);
 
   lastBankPtr_ = &cartridge_.getROM()[cartridge_.getROM().size() - 0x4000];
+  updateWindows();
+}
+
+void Mapper_2::SnapshotTo(StateBuffer &buffer) {
+  Mapper::SnapshotTo(buffer);
+  buffer.Put(static_cast<const Mapper2State &>(*this));
+}
+
+void Mapper_2::RestoreFrom(StateBuffer &buffer) {
+  Mapper::RestoreFrom(buffer);
+  buffer.Get(static_cast<Mapper2State &>(*this));
+
+  lastBankPtr_ = &cartridge_.getROM()[cartridge_.getROM().size() - 0x4000];
+  updateWindows();
 }
 
 }  // namespace hn
@@ -2,7 +2,13 @@
 #include "Mapper.h"
 
 namespace hn {
-class Mapper_2 : public Mapper {
+// Registers of the mapper, plain data for one-copy snapshots
+struct Mapper2State {
+  bool usesCharacterRAM_;
+  Address selectPRG_;
+};
+
+class Mapper_2 : public Mapper, private Mapper2State {
  public:
   Mapper_2(Cartridge &cart);
   virtual void Reset() override;
@@ -16,11 +22,12 @@ class Mapper_2 : public Mapper {
 
   virtual void Save(std::ostream &os) override;
   virtual void Restore(std::istream &is) override;
+  virtual void SnapshotTo(StateBuffer &buffer) override;
+  virtual void RestoreFrom(StateBuffer &buffer) override;
 
  private:
-  bool usesCharacterRAM_;
+  void updateWindows();
 
   const Byte *lastBankPtr_;
-  Address selectPRG_;
 };
 }  // namespace hn
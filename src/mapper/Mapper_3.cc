@@ -2,7 +2,9 @@
 #include "glog/logging.h"
 
 namespace hn {
-Mapper_3::Mapper_3(Cartridge &cart) : Mapper(cart, 3) {}
+Mapper_3::Mapper_3(Cartridge &cart) : Mapper(cart, 3) {
+  ClearState<Mapper3State>(this);
+}
 
 void Mapper_3::Reset() {
   selectCHR_ = 0;
@@ -11,6 +13,19 @@ void Mapper_3::Reset() {
   } else {  // 2 banks
     oneBank_ = false;
   }
+
+  updateWindows();
+}
+
+void Mapper_3::updateWindows() {
+  if (oneBank_) {
+    MapPRG(0, 0, 2);
+    MapPRG(2, 0, 2);
+  } else {
+    MapPRG(0, 0, 4);
+  }
+
+  MapCHR(0, cartridge_.getVROM(), selectCHR_ << 13, 8);
 }
 
 Byte Mapper_3::readPRG(Address addr) {
@@ -21,7 +36,10 @@ Byte Mapper_3::readPRG(Address addr) {
   }
 }
 
-void Mapper_3::writePRG(Address addr, Byte value) { selectCHR_ = value & 0x3; }
+void Mapper_3::writePRG(Address addr, Byte value) {
+  selectCHR_ = value & 0x3;
+  MapCHR(0, cartridge_.getVROM(), selectCHR_ << 13, 8);
+}
 
 Byte Mapper_3::readCHR(Address addr) {
   // selectCHR_ * 0x2000 + addr
@@ -44,6 +62,20 @@ void Mapper_3::Restore(std::istream &is) {
 
   Read(is, oneBank_);
   Read(is, selectCHR_);
+
+  updateWindows();
+}
+
+void Mapper_3::SnapshotTo(StateBuffer &buffer) {
+  Mapper::SnapshotTo(buffer);
+  buffer.Put(static_cast<const Mapper3State &>(*this));
+}
+
+void Mapper_3::RestoreFrom(StateBuffer &buffer) {
+  Mapper::RestoreFrom(buffer);
+  buffer.Get(static_cast<Mapper3State &>(*this));
+
+  updateWindows();
 }
 
 }  // namespace hn
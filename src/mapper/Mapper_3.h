@@ -3,7 +3,14 @@
 #include "Mapper.h"
 
 namespace hn {
-class Mapper_3 : public Mapper {
+// Registers of the mapper, plain data for one-copy snapshots
+struct Mapper3State {
+  bool oneBank_;
+
+  Address selectCHR_;
+};
+
+class Mapper_3 : public Mapper, private Mapper3State {
  public:
   Mapper_3(Cartridge &cart);
   virtual void Reset() override;
@@ -17,10 +24,10 @@ class Mapper_3 : public Mapper {
 
   virtual void Save(std::ostream &os) override;
   virtual void Restore(std::istream &is) override;
+  virtual void SnapshotTo(StateBuffer &buffer) override;
+  virtual void RestoreFrom(StateBuffer &buffer) override;
 
  private:
-  bool oneBank_;
-
-  Address selectCHR_;
+  void updateWindows();
 };
 }  // namespace hn
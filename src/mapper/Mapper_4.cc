@@ -5,7 +5,9 @@
 
 namespace hn {
 
-Mapper_4::Mapper_4(Cartridge &cart) : Mapper(cart, 4) {}
+Mapper_4::Mapper_4(Cartridge &cart) : Mapper(cart, 4) {
+  ClearState<Mapper4State>(this);
+}
 
 void Mapper_4::Reset() {
   usesCharacterRAM_ = cartridge_.getVROM().empty();
@@ -25,16 +27,15 @@ void Mapper_4::Reset() {
   nIRQReload = 0x00;
   nLatch_ = 0;
 
-  pRegister.resize(8);
-  pCHRBank.resize(8);
-  pPRGBank.resize(4);
-
   pPRGBank[0] = 0;
   pPRGBank[1] = 1;
 
   rom_num_ = cartridge_.getROM().size() >> 13;
   pPRGBank[2] = rom_num_ - 2;
   pPRGBank[3] = rom_num_ - 1;
+
+  mapPRGBanks();
+  mapCHRBanks();
 }
 
 void Mapper_4::writePRG(Address addr, Byte data) {
@@ -124,6 +125,8 @@ void Mapper_4::updateCPUBank() {
   }
   pPRGBank[1] = (pRegister[7] & 0x3F) % rom_num_;
   pPRGBank[3] = rom_num_ - 1;
+
+  mapPRGBanks();
 }
 
 void Mapper_4::updatePPUBank() {
@@ -147,6 +150,21 @@ void Mapper_4::updatePPUBank() {
     pCHRBank[6] = pRegister[4];
     pCHRBank[7] = pRegister[5];
   }
+
+  mapCHRBanks();
+}
+
+void Mapper_4::mapPRGBanks() {
+  for (int i = 0; i < 4; ++i) {
+    MapPRG(i, pPRGBank[i] << 13);
+  }
+}
+
+// Without CHR ROM the windows stay null, and reads keep reporting errors
+void Mapper_4::mapCHRBanks() {
+  for (int i = 0; i < 8; ++i) {
+    MapCHR(i, cartridge_.getVROM(), pCHRBank[i] << 10);
+  }
 }
 
 void Mapper_4::Hsync(int scanline) {
@@ -227,6 +245,22 @@ void Mapper_4::Restore(std::istream &is) {
 
   Read(is, pCHRBank);
   Read(is, pPRGBank);
+
+  mapPRGBanks();
+  mapCHRBanks();
+}
+
+void Mapper_4::SnapshotTo(StateBuffer &buffer) {
+  Mapper::SnapshotTo(buffer);
+  buffer.Put(static_cast<const Mapper4State &>(*this));
+}
+
+void Mapper_4::RestoreFrom(StateBuffer &buffer) {
+  Mapper::RestoreFrom(buffer);
+  buffer.Get(static_cast<Mapper4State &>(*this));
+
+  mapPRGBanks();
+  mapCHRBanks();
 }
 
 };  // namespace hn
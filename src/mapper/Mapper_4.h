@@ -3,7 +3,32 @@
 #include "Mapper.h"
 
 namespace hn {
-class Mapper_4 : public Mapper {
+// Registers of the mapper, plain data for one-copy snapshots
+struct Mapper4State {
+  bool usesCharacterRAM_;
+  size_t rom_num_;
+
+  // Data: 0b 1   1 ---   111
+  //         CHR PRG    Register_Index
+  Byte targetRegister_;
+  bool bPRGBankMode;
+  bool bCHRInversion;  // Invert
+
+  std::array<Byte, 8> pRegister;
+
+  std::array<Address, 8> pCHRBank;
+  std::array<Address, 4> pPRGBank;
+
+  bool bIRQActive;
+  bool bIRQEnable;
+  bool bIRQUpdate;
+
+  Byte nIRQCounter;
+  Byte nIRQReload;
+  Byte nLatch_;
+};
+
+class Mapper_4 : public Mapper, private Mapper4State {
  public:
   Mapper_4(Cartridge &cart);
 
@@ -21,33 +46,14 @@ class Mapper_4 : public Mapper {
 
   virtual void Save(std::ostream &os) override;
   virtual void Restore(std::istream &is) override;
+  virtual void SnapshotTo(StateBuffer &buffer) override;
+  virtual void RestoreFrom(StateBuffer &buffer) override;
 
  protected:
   void updatePPUBank();
   void updateCPUBank();
-
- private:
-  bool usesCharacterRAM_;
-  size_t rom_num_;
-
-  // Data: 0b 1   1 ---   111
-  //         CHR PRG    Register_Index
-  Byte targetRegister_;
-  bool bPRGBankMode;
-  bool bCHRInversion;  // Invert
-
-  std::vector<Byte> pRegister;
-
-  std::vector<Address> pCHRBank;
-  std::vector<Address> pPRGBank;
-
-  bool bIRQActive;
-  bool bIRQEnable;
-  bool bIRQUpdate;
-
-  Byte nIRQCounter;
-  Byte nIRQReload;
-  Byte nLatch_;
+  void mapPRGBanks();
+  void mapCHRBanks();
 };
 
 }  // namespace hn
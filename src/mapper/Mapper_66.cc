@@ -4,7 +4,9 @@
 
 namespace hn {
 
-Mapper_66::Mapper_66(Cartridge &cart) : Mapper(cart, 66) {}
+Mapper_66::Mapper_66(Cartridge &cart) : Mapper(cart, 66) {
+  ClearState<Mapper66State>(this);
+}
 
 Mapper_66::~Mapper_66() {}
 
@@ -14,11 +16,18 @@ void Mapper_66::Reset() {
 
   prgRom_ = cartridge_.getROM().size() >> 10;
   chrRom_ = cartridge_.getVROM().size() >> 10;
+  updateWindows();
 }
 
 void Mapper_66::writePRG(Address addr, Byte data) {
   prgBank_ = (data >> 4) & 3;
   chrBank_ = data & 3;
+  updateWindows();
+}
+
+void Mapper_66::updateWindows() {
+  MapPRG(0, prgBank_ << 15, 4);
+  MapCHR(0, cartridge_.getVROM(), chrBank_ << 13, 8);
 }
 
 Byte Mapper_66::readPRG(Address addr) {  //
@@ -55,4 +64,16 @@ void Mapper_66::writeCHR(Address addr, Byte value) {
 }
 
 void Mapper_66::DebugDump() {}
+
+void Mapper_66::SnapshotTo(StateBuffer &buffer) {
+  Mapper::SnapshotTo(buffer);
+  buffer.Put(static_cast<const Mapper66State &>(*this));
+}
+
+void Mapper_66::RestoreFrom(StateBuffer &buffer) {
+  Mapper::RestoreFrom(buffer);
+  buffer.Get(static_cast<Mapper66State &>(*this));
+
+  updateWindows();
+}
 };  // namespace hn
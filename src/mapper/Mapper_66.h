@@ -3,7 +3,15 @@
 #include "Mapper.h"
 
 namespace hn {
-class Mapper_66 : public Mapper {
+// Registers of the mapper, plain data for one-copy snapshots
+struct Mapper66State {
+  Byte prgBank_;
+  Byte chrBank_;
+  Byte prgRom_;
+  Byte chrRom_;
+};
+
+class Mapper_66 : public Mapper, private Mapper66State {
  public:
   Mapper_66(Cartridge &cart);
   ~Mapper_66();
@@ -19,12 +27,12 @@ class Mapper_66 : public Mapper {
 
   virtual void DebugDump() override;
 
+  virtual void SnapshotTo(StateBuffer &buffer) override;
+  virtual void RestoreFrom(StateBuffer &buffer) override;
+
  protected:
  private:
-  Byte prgBank_;
-  Byte chrBank_;
-  Byte prgRom_;
-  Byte chrRom_;
+  void updateWindows();
 };
 
 }  // namespace hn
@@ -4,7 +4,9 @@
 
 namespace hn {
 
-Mapper_7::Mapper_7(Cartridge &cart) : Mapper(cart, 7) {}
+Mapper_7::Mapper_7(Cartridge &cart) : Mapper(cart, 7) {
+  ClearState<Mapper7State>(this);
+}
 
 void Mapper_7::Reset() {
   prgBank_ = 0;
@@ -17,10 +19,17 @@ void Mapper_7::Reset() {
   }
 
   ChangeNTMirroring(OneScreenLower);
+  updateWindows();
+}
+
+void Mapper_7::updateWindows() {
+  MapPRG(0, prgBank_ << 15, 4);
+  MapCHR(0, chrVRam_ ? vRam_ : cartridge_.getVROM(), 0, 8);
 }
 
 void Mapper_7::writePRG(Address addr, Byte data) {
   prgBank_ = (data & 7) % prgRom_;
+  MapPRG(0, prgBank_ << 15, 4);
 
   ChangeNTMirroring((data & 0x10) ? OneScreenHigher : OneScreenLower);
 }
@@ -72,5 +81,19 @@ void Mapper_7::Restore(std::istream &is) {
   Read(is, prgBank_);
   Read(is, prgRom_);
   Read(is, chrVRam_);
+
+  updateWindows();
+}
+
+void Mapper_7::SnapshotTo(StateBuffer &buffer) {
+  Mapper::SnapshotTo(buffer);
+  buffer.Put(static_cast<const Mapper7State &>(*this));
+}
+
+void Mapper_7::RestoreFrom(StateBuffer &buffer) {
+  Mapper::RestoreFrom(buffer);
+  buffer.Get(static_cast<Mapper7State &>(*this));
+
+  updateWindows();
 }
 };  // namespace hn
@@ -3,7 +3,14 @@
 #include "Mapper.h"
 
 namespace hn {
-class Mapper_7 : public Mapper {
+// Registers of the mapper, plain data for one-copy snapshots
+struct Mapper7State {
+  Byte prgBank_;
+  Byte prgRom_;
+  bool chrVRam_;
+};
+
+class Mapper_7 : public Mapper, private Mapper7State {
  public:
   Mapper_7(Cartridge &cart);
 
@@ -20,12 +27,12 @@ class Mapper_7 : public Mapper {
 
   virtual void Save(std::ostream &os) override;
   virtual void Restore(std::istream &is) override;
+  virtual void SnapshotTo(StateBuffer &buffer) override;
+  virtual void RestoreFrom(StateBuffer &buffer) override;
 
  protected:
  private:
-  Byte prgBank_;
-  Byte prgRom_;
-  bool chrVRam_;
+  void updateWindows();
 };
 
 }  // namespace hn
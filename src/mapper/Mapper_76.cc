@@ -33,19 +33,21 @@
 //
 namespace hn {
 
-Mapper_76::Mapper_76(Cartridge &cart) : Mapper(cart, 76) {}
+Mapper_76::Mapper_76(Cartridge &cart) : Mapper(cart, 76) {
+  ClearState<Mapper76State>(this);
+}
 
 void Mapper_76::Reset() {
   prgRom_ = cartridge_.getROM().size() >> 13;
 
   selReg_ = 0;
-  regs_.resize(8);
   regs_[2] = 0;
   regs_[3] = 1;
   regs_[4] = 2;
   regs_[5] = 3;
   regs_[6] = 0;
   regs_[7] = 1;
+  updateWindows();
 }
 
 void Mapper_76::writePRG(Address addr, Byte data) {
@@ -55,6 +57,7 @@ void Mapper_76::writePRG(Address addr, Byte data) {
       break;
     case 0x8001:
       regs_[selReg_] = data & 0x3f;
+      updateWindows();
       break;
     default:
       LOG(ERROR) << "writePRG @" << std::hex << addr << " is not supported";
@@ -89,6 +92,16 @@ Byte Mapper_76::readCHR(Address addr) {
   return cartridge_.getVROM()[vaddr];
 }
 
+void Mapper_76::updateWindows() {
+  MapPRG(0, regs_[6] << 13);
+  MapPRG(1, regs_[7] << 13);
+  MapPRG(2, (prgRom_ - 2) << 13, 2);
+
+  for (int i = 0; i < 4; ++i) {
+    MapCHR(i * 2, cartridge_.getVROM(), regs_[2 + i] << 11, 2);
+  }
+}
+
 void Mapper_76::writeCHR(Address addr, Byte value) {
   LOG(ERROR) << "writeCHR @" << std::hex << addr << " is not supported";
 }
@@ -109,5 +122,19 @@ void Mapper_76::Restore(std::istream &is) {
   Read(is, prgRom_);
   Read(is, selReg_);
   Read(is, regs_);
+
+  updateWindows();
+}
+
+void Mapper_76::SnapshotTo(StateBuffer &buffer) {
+  Mapper::SnapshotTo(buffer);
+  buffer.Put(static_cast<const Mapper76State &>(*this));
+}
+
+void Mapper_76::RestoreFrom(StateBuffer &buffer) {
+  Mapper::RestoreFrom(buffer);
+  buffer.Get(static_cast<Mapper76State &>(*this));
+
+  updateWindows();
 }
 };  // namespace hn
@@ -3,7 +3,14 @@
 #include "Mapper.h"
 
 namespace hn {
-class Mapper_76 : public Mapper {
+// Registers of the mapper, plain data for one-copy snapshots
+struct Mapper76State {
+  std::array<Byte, 8> regs_;
+  Byte selReg_;
+  size_t prgRom_;
+};
+
+class Mapper_76 : public Mapper, private Mapper76State {
  public:
   Mapper_76(Cartridge &cart);
 
@@ -20,12 +27,12 @@ class Mapper_76 : public Mapper {
 
   virtual void Save(std::ostream &os) override;
   virtual void Restore(std::istream &is) override;
+  virtual void SnapshotTo(StateBuffer &buffer) override;
+  virtual void RestoreFrom(StateBuffer &buffer) override;
 
  protected:
  private:
-  std::vector<Byte> regs_;
-  Byte selReg_;
-  size_t prgRom_;
+  void updateWindows();
 };
 
 }  // namespace hn
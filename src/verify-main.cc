@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "core/EmulatorHeadless.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+DEFINE_int32(jobs, 0, "Specify the number of replays run at once, 0 for one "
+                      "per core");
+DEFINE_bool(catchup, false,
+            "Run the CPU an instruction at a time and catch up the other "
+            "devices lazily");
+DEFINE_int32(frameskip, 0,
+             "Skip the picture of N frames out of every N+1, the checked "
+             "frames are always drawn");
+
+namespace {
+
+struct Job {
+  std::string rom;
+  std::string replay;
+
+  std::string error;
+  std::size_t frames = 0;
+  std::size_t checked = 0;
+  std::size_t mismatched = 0;
+  double seconds = 0;
+};
+
+// Lines of "ROM replay", blank lines and lines from # on are left out
+bool ReadJobs(const std::string &path, std::vector<Job> &jobs) {
+  std::ifstream file(path);
+  if (!file) {
+    LOG(ERROR) << "Can not open the job list: " << path;
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(file, line)) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream ss(line);
+    Job job;
+    if (!(ss >> job.rom)) continue;
+    if (!(ss >> job.replay)) {
+      LOG(ERROR) << "No replay for " << job.rom;
+      return false;
+    }
+    jobs.push_back(job);
+  }
+  return true;
+}
+
+void RunJob(Job &job) {
+  hn::Cartridge cart;
+  if (!cart.loadFromFile(job.rom)) {
+    job.error = "load ROM failed";
+    return;
+  }
+
+  // One emulator per job, nothing is shared between the threads
+  hn::EmulatorHeadless emulator;
+  emulator.setCartridge(cart);
+  emulator.SetRecordMode(true, job.replay);
+  emulator.setScheduler(FLAGS_catchup ? hn::Emulator::CATCH_UP
+                                      : hn::Emulator::CYCLE_STEP);
+  emulator.setFrameSkip(FLAGS_frameskip, FLAGS_frameskip + 1);
+  emulator.run();
+
+  job.frames = emulator.framesRun();
+  job.seconds = emulator.seconds();
+  job.checked = emulator.checkedFrames();
+  job.mismatched = emulator.mismatchedFrames();
+  if (job.checked == 0) {
+    job.error = "nothing to check";
+  }
+}
+
+}  // namespace
+
+// Replays recordings headlessly on every core, checking them against the
+// hashes taken while recording
+int main(int argc, char **argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (argc < 2) {
+    LOG(ERROR) << "Argument required: job list";
+    return 1;
+  }
+
+  std::vector<Job> jobs;
+  for (int i = 1; i < argc; i++) {
+    if (!ReadJobs(argv[i], jobs)) return 1;
+  }
+
+  int threads =
+      FLAGS_jobs > 0 ? FLAGS_jobs : std::thread::hardware_concurrency();
+  threads = std::max(1, std::min<int>(threads, jobs.size()));
+
+  auto start = std::chrono::high_resolution_clock::now();
+  std::atomic<std::size_t> next(0);
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; i++) {
+    workers.emplace_back([&]() {
+      for (std::size_t job = next++; job < jobs.size(); job = next++) {
+        RunJob(jobs[job]);
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::high_resolution_clock::now() - start;
+
+  std::size_t failed = 0, frames = 0;
+  for (auto &job : jobs) {
+    frames += job.frames;
+    bool ok = job.error.empty() && job.mismatched == 0;
+    failed += !ok;
+
+    std::cout << (ok ? "OK   " : "FAIL ") << job.rom << " " << job.replay;
+    if (!job.error.empty()) {
+      std::cout << ": " << job.error;
+    } else {
+      std::cout << ": " << job.mismatched << " of " << job.checked
+                << " checks differ, " << job.frames << " frames";
+      // Replays of no frame may take no measurable time
+      if (job.seconds > 0) {
+        std::cout << ", " << job.frames / job.seconds << " fps";
+      }
+    }
+    std::cout << std::endl;
+  }
+
+  std::cout << jobs.size() << " replays, " << failed << " failed, " << frames
+            << " frames in " << elapsed.count() << "s on " << threads
+            << " threads" << std::endl;
+
+  return failed ? 1 : 0;
+}